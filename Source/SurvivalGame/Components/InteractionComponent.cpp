@@ -4,6 +4,11 @@
 #include "InteractionComponent.h"
 #include "../Player/SurvivalCharacter.h"
 #include "../Widget/InteractionWidget.h"
+#include "../Widget/InteractionWidgetSubsystem.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/GameStateBase.h"
+#include "Net/UnrealNetwork.h"
+#include "InteractionSubsystem.h"
 
 UInteractionComponent::UInteractionComponent()
 {
@@ -14,6 +19,11 @@ UInteractionComponent::UInteractionComponent()
 	InteractableNameText = FText::FromString("InteractableObject");
 	InteractableActionText = FText::FromString("Interact");
 	bAllowMultipleInteractors = true;
+	bReplicateInteractionProgress = false;
+	InteractionStartTime = -1.f;
+
+	bHighlightComponentsGathered = false;
+	bHighlighted = false;
 
 	Space = EWidgetSpace::Screen;
 	DrawSize = FIntPoint(600, 100);
@@ -24,6 +34,105 @@ UInteractionComponent::UInteractionComponent()
 
 }
 
+void UInteractionComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (bReplicateInteractionProgress && GetOwner() && GetOwner()->HasAuthority())
+	{
+		SetIsReplicated(true);
+	}
+
+	//Only tick while focused and showing the widget
+	SetComponentTickEnabled(GetUserWidgetObject() != nullptr);
+}
+
+void UInteractionComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(UInteractionComponent, InteractionStartTime);
+}
+
+void UInteractionComponent::InitWidget()
+{
+	//Only game world copies hand the class over, the serialized property of the component in an editor world stays as set up
+	if (WidgetClass && GetWorld() && GetWorld()->IsGameWorld())
+	{
+		InteractionWidgetClass = WidgetClass;
+		WidgetClass = nullptr;
+	}
+
+	Super::InitWidget();
+}
+
+void UInteractionComponent::AcquireInteractionWidget(ASurvivalCharacter* SCharacter)
+{
+	if (!InteractionWidgetClass || !InteractionWidgetClass->IsChildOf(UInteractionWidget::StaticClass()) || !SCharacter->IsLocallyControlled())
+	{
+		return;
+	}
+
+	if (UInteractionWidget* InteractionWidget = UInteractionWidgetSubsystem::AcquireWidget(this, InteractionWidgetClass.Get(), Cast<APlayerController>(SCharacter->GetController())))
+	{
+		if (InteractionWidget != GetUserWidgetObject())
+		{
+			SetWidget(InteractionWidget);
+		}
+		SetComponentTickEnabled(true);
+	}
+}
+
+void UInteractionComponent::ReleaseInteractionWidget()
+{
+	if (UInteractionWidget* InteractionWidget = Cast<UInteractionWidget>(GetUserWidgetObject()))
+	{
+		UInteractionWidgetSubsystem::ReleaseWidget(InteractionWidget, this);
+		SetWidget(nullptr);
+		SetComponentTickEnabled(false);
+	}
+}
+
+void UInteractionComponent::OnRegister()
+{
+	Super::OnRegister();
+
+	//The owner may still be registering the rest of its components, gather them the first time we get focused
+	HighlightComponents.Reset();
+	bHighlightComponentsGathered = false;
+	bHighlighted = false;
+
+	if (UInteractionSubsystem* InteractionSubsystem = GetWorld() ? GetWorld()->GetSubsystem<UInteractionSubsystem>() : nullptr)
+	{
+		InteractionSubsystem->RegisterInteractable(this);
+	}
+}
+
+void UInteractionComponent::OnUnregister()
+{
+	if (UInteractionSubsystem* InteractionSubsystem = GetWorld() ? GetWorld()->GetSubsystem<UInteractionSubsystem>() : nullptr)
+	{
+		InteractionSubsystem->UnregisterInteractable(this);
+	}
+
+	Super::OnUnregister();
+}
+
+void UInteractionComponent::OnUpdateTransform(EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport)
+{
+	Super::OnUpdateTransform(UpdateTransformFlags, Teleport);
+
+	if (UInteractionSubsystem* InteractionSubsystem = GetWorld() ? GetWorld()->GetSubsystem<UInteractionSubsystem>() : nullptr)
+	{
+		InteractionSubsystem->UpdateInteractable(this);
+	}
+}
+
+FBoxSphereBounds UInteractionComponent::GetInteractionBounds() const
+{
+	return GetAttachParent() ? GetAttachParent()->Bounds : Bounds;
+}
+
 void UInteractionComponent::Deactivate()
 {
 	Super::Deactivate();
@@ -64,18 +173,8 @@ void UInteractionComponent::BeginFocus(class ASurvivalCharacter* SCharacter)
 	OnBeginInteract.Broadcast(SCharacter);
 
 	SetHiddenInGame(false);
-
-	if (!GetOwner()->HasAuthority())
-	{
-		for (auto& Comps : GetOwner()->GetComponents())
-		{
-			if (UPrimitiveComponent* Prim = Cast<UPrimitiveComponent>(Comps))
-			{
-				Prim->SetRenderCustomDepth(true);
-
-			}
-		}
-	}
+	SetHighlighted(true);
+	AcquireInteractionWidget(SCharacter);
 
 	RefreshWidget();
 }
@@ -85,28 +184,62 @@ void UInteractionComponent::EndFocus(class ASurvivalCharacter* SCharacter)
 	OnEndFocus.Broadcast(SCharacter);
 
 	SetHiddenInGame(true);
+	SetHighlighted(false);
+	ReleaseInteractionWidget();
+}
 
-	TArray<UPrimitiveComponent*> out_components;
-	GetOwner()->GetComponents<UPrimitiveComponent>(out_components, true);
+void UInteractionComponent::SetHighlighted(const bool bNewHighlighted)
+{
+	if (bHighlighted == bNewHighlighted || !GetOwner() || GetOwner()->HasAuthority())
+	{
+		return;
+	}
+
+	bHighlighted = bNewHighlighted;
+
+	if (!bHighlightComponentsGathered)
+	{
+		GatherHighlightComponents();
+	}
 
-	if (!GetOwner()->HasAuthority())
+	for (const TWeakObjectPtr<UPrimitiveComponent>& HighlightComponent : HighlightComponents)
 	{
-		for (auto& VisualComp : out_components)
+		UPrimitiveComponent* Prim = HighlightComponent.Get();
+		if (Prim && Prim->bRenderCustomDepth != bNewHighlighted)
 		{
-			if (UPrimitiveComponent* Prim = Cast<UPrimitiveComponent>(VisualComp))
-			{
-				Prim->SetRenderCustomDepth(false);
-			}
+			Prim->SetRenderCustomDepth(bNewHighlighted);
 		}
 	}
 }
 
+void UInteractionComponent::GatherHighlightComponents()
+{
+	HighlightComponents.Reset();
+
+	GetOwner()->ForEachComponent<UPrimitiveComponent>(true, [this](UPrimitiveComponent* Prim)
+	{
+		//Our own widget doesn't get outlined
+		if (Prim != this)
+		{
+			HighlightComponents.Add(Prim);
+		}
+	});
+
+	bHighlightComponentsGathered = true;
+}
+
 void UInteractionComponent::BeginInteract(class ASurvivalCharacter* SCharacter)
 {
 	if (CanInteract(SCharacter))
 	{
 		Interactors.AddUnique(SCharacter);
 		OnBeginInteract.Broadcast(SCharacter);
+
+		//Progress follows the first interactor
+		if (InteractionStartTime < 0.f)
+		{
+			SetInteractionStartTime(GetInteractionClockTime(GetWorld()));
+		}
 	}
 }
 
@@ -114,6 +247,11 @@ void UInteractionComponent::EndInteract(class ASurvivalCharacter* SCharacter)
 {
 	Interactors.RemoveSingle(SCharacter);
 	OnEndInteract.Broadcast(SCharacter);
+
+	if (Interactors.Num() == 0)
+	{
+		SetInteractionStartTime(-1.f);
+	}
 }
 
 void UInteractionComponent::Interact(class ASurvivalCharacter* SCharacter)
@@ -126,19 +264,38 @@ void UInteractionComponent::Interact(class ASurvivalCharacter* SCharacter)
 
 float UInteractionComponent::GetInteractPercentage()
 {
-	if (Interactors.IsValidIndex(0))
+	if (InteractionStartTime >= 0.f && InteractionTime > 0.f)
 	{
-		if (ASurvivalCharacter* Interactor = Interactors[0])
-		{
-			if (Interactor && Interactor->IsInteracting())
-			{
-				return 1.f - FMath::Abs(Interactor->GetRemainingInteractionTime() / InteractionTime);
-			}
-		}
+		return FMath::Clamp((GetInteractionClockTime(GetWorld()) - InteractionStartTime) / InteractionTime, 0.f, 1.f);
 	}
 	return 0;
 }
 
+float UInteractionComponent::GetInteractionClockTime(const UWorld* World)
+{
+	if (!World)
+	{
+		return 0.f;
+	}
+
+	const AGameStateBase* GameState = World->GetGameState();
+	return GameState ? GameState->GetServerWorldTimeSeconds() : World->GetTimeSeconds();
+}
+
+void UInteractionComponent::SetInteractionStartTime(const float NewStartTime)
+{
+	if (InteractionStartTime != NewStartTime)
+	{
+		InteractionStartTime = NewStartTime;
+		RefreshWidget();
+	}
+}
+
+void UInteractionComponent::OnRep_InteractionStartTime()
+{
+	RefreshWidget();
+}
+
 void UInteractionComponent::SetInteractableNameText(const FText& NewNameText)
 {
 	InteractableNameText = NewNameText;
@@ -26,6 +26,8 @@ class SURVIVALGAME_API UInteractionComponent : public UWidgetComponent
 	public:
 		UInteractionComponent();
 		virtual void Deactivate() override;
+		//The widget is borrowed from the focusing player's interaction widget subsystem instead of created per component
+		virtual void InitWidget() override;
 		bool CanInteract(ASurvivalCharacter* Character) const;
 		void RefreshWidget();
 
@@ -37,16 +39,44 @@ class SURVIVALGAME_API UInteractionComponent : public UWidgetComponent
 
 		void Interact( ASurvivalCharacter* SCharacter);
 
+		//Computed from the published start time, widgets should compute it themselves from GetInteractionStartTime
 		UFUNCTION(BlueprintPure, Category = "Interaction")
 			float GetInteractPercentage();
 
+		//Server world time the current interaction started at, negative while nobody is interacting
+		UFUNCTION(BlueprintPure, Category = "Interaction")
+			float GetInteractionStartTime() const { return InteractionStartTime; }
+
+		//The clock interaction start times are measured in, the server's world time so it lines up across machines
+		static float GetInteractionClockTime(const UWorld* World);
+
 		UFUNCTION(BlueprintCallable, Category = "Interaction")
 			void SetInteractableNameText(const FText& NewNameText);
 
 		UFUNCTION(BlueprintCallable, Category = "Interaction")
 			void SetInteractableActionText(const FText& NewActionText);
+
+		//Bounds of what the player traces against to find this interactable, the component we are attached to
+		FBoxSphereBounds GetInteractionBounds() const;
 	protected:
+		virtual void BeginPlay() override;
+		virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+		void SetInteractionStartTime(const float NewStartTime);
+
+		UFUNCTION()
+			void OnRep_InteractionStartTime();
+		virtual void OnRegister() override;
+		virtual void OnUnregister() override;
+		virtual void OnUpdateTransform(EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport = ETeleportType::None) override;
 	private:
+		//Turns the custom depth outline on the owner's primitives on or off, only on clients
+		void SetHighlighted(const bool bNewHighlighted);
+		void GatherHighlightComponents();
+
+		//Borrow the local player's widget while focused and hand it back afterwards
+		void AcquireInteractionWidget(ASurvivalCharacter* SCharacter);
+		void ReleaseInteractionWidget();
 	/*---------------------------------*/
 	
 	/*---------------VARS--------------*/
@@ -86,10 +116,26 @@ class SURVIVALGAME_API UInteractionComponent : public UWidgetComponent
 		//Whether we allow multiple players to interact with the object at the same time
 		UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Interaction")
 			bool bAllowMultipleInteractors;
+
+		//Replicate when interactions start so other players see the progress too, otherwise only the interacting player does
+		UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Interaction")
+			bool bReplicateInteractionProgress;
 	protected:
+		UPROPERTY(ReplicatedUsing = OnRep_InteractionStartTime)
+			float InteractionStartTime;
+
 		UPROPERTY()
 			TArray< ASurvivalCharacter*> Interactors;
 
 	private:
+		//The widget class set up on the component. In game worlds WidgetClass is emptied so no widget gets created up front
+		UPROPERTY(Transient)
+			TSubclassOf<UUserWidget> InteractionWidgetClass;
+
+		//The owner's primitives that get outlined while focused, gathered once after we register
+		TArray<TWeakObjectPtr<UPrimitiveComponent>, TInlineAllocator<4>> HighlightComponents;
+
+		bool bHighlightComponentsGathered;
+		bool bHighlighted;
 	/*---------------------------------*/
 };
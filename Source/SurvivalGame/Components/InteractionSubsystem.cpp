@@ -0,0 +1,448 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "InteractionSubsystem.h"
+#include "Components/InteractionComponent.h"
+#include "Player/SurvivalCharacter.h"
+#include "Engine/World.h"
+
+UInteractionSubsystem::UInteractionSubsystem()
+{
+	CellSize = 1000.f;
+	CandidateMargin = 100.f;
+	MaxCandidateRadius = 0.f;
+
+	bInitialized = false;
+	NextTraceId = 0;
+	NextInteractionId = 0;
+}
+
+void UInteractionSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	InteractionTraceDelegate.BindUObject(this, &UInteractionSubsystem::OnInteractionTraceCompleted);
+	bInitialized = true;
+}
+
+void UInteractionSubsystem::Deinitialize()
+{
+	bInitialized = false;
+
+	PendingChecks.Empty();
+	InFlightChecks.Empty();
+	InteractionTraceDelegate.Unbind();
+
+	ScheduledInteractions.Empty();
+	ScheduledInteractionIndices.Empty();
+
+	Cells.Empty();
+	InteractableCells.Empty();
+	InteractablesByActor.Empty();
+
+	Super::Deinitialize();
+}
+
+FIntPoint UInteractionSubsystem::GetCellForLocation(const FVector& Location) const
+{
+	return FIntPoint(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize));
+}
+
+void UInteractionSubsystem::RegisterInteractable(UInteractionComponent* Interactable)
+{
+	if (!Interactable || InteractableCells.Contains(Interactable))
+	{
+		return;
+	}
+
+	const FIntPoint Cell = GetCellForLocation(Interactable->GetComponentLocation());
+	Cells.FindOrAdd(Cell).Add(Interactable);
+	InteractableCells.Add(Interactable, Cell);
+
+	//Like GetComponentByClass, an actor with several interactables resolves to the first one
+	if (const AActor* Owner = Interactable->GetOwner())
+	{
+		if (!InteractablesByActor.Contains(Owner))
+		{
+			InteractablesByActor.Add(Owner, Interactable);
+		}
+	}
+
+	MaxCandidateRadius = FMath::Max(MaxCandidateRadius, Interactable->GetInteractionBounds().SphereRadius);
+}
+
+void UInteractionSubsystem::UnregisterInteractable(UInteractionComponent* Interactable)
+{
+	FIntPoint Cell;
+	if (InteractableCells.RemoveAndCopyValue(Interactable, Cell))
+	{
+		const AActor* Owner = Interactable->GetOwner();
+		if (UInteractionComponent** PublishedInteractable = InteractablesByActor.Find(Owner))
+		{
+			if (*PublishedInteractable == Interactable)
+			{
+				InteractablesByActor.Remove(Owner);
+			}
+		}
+
+		if (TArray<UInteractionComponent*>* CellInteractables = Cells.Find(Cell))
+		{
+			CellInteractables->RemoveSingleSwap(Interactable, false);
+			if (CellInteractables->Num() == 0)
+			{
+				Cells.Remove(Cell);
+			}
+		}
+	}
+}
+
+void UInteractionSubsystem::UpdateInteractable(UInteractionComponent* Interactable)
+{
+	FIntPoint* CurrentCell = InteractableCells.Find(Interactable);
+	if (!CurrentCell)
+	{
+		return;
+	}
+
+	MaxCandidateRadius = FMath::Max(MaxCandidateRadius, Interactable->GetInteractionBounds().SphereRadius);
+
+	const FIntPoint NewCell = GetCellForLocation(Interactable->GetComponentLocation());
+	if (NewCell != *CurrentCell)
+	{
+		if (TArray<UInteractionComponent*>* OldCellInteractables = Cells.Find(*CurrentCell))
+		{
+			OldCellInteractables->RemoveSingleSwap(Interactable, false);
+			if (OldCellInteractables->Num() == 0)
+			{
+				Cells.Remove(*CurrentCell);
+			}
+		}
+		Cells.FindOrAdd(NewCell).Add(Interactable);
+		*CurrentCell = NewCell;
+	}
+}
+
+UInteractionComponent* UInteractionSubsystem::FindInteractableForActor(const AActor* Actor) const
+{
+	UInteractionComponent* const* Interactable = InteractablesByActor.Find(Actor);
+	return Interactable ? *Interactable : nullptr;
+}
+
+bool UInteractionSubsystem::FindCandidatesInView(const FVector& ViewLocation, const FVector& ViewDirection, const float MaxDistance, const AActor* IgnoredActor, TArray<UInteractionComponent*>* OutCandidates /*= nullptr*/) const
+{
+	const float QueryRadius = MaxDistance + MaxCandidateRadius + CandidateMargin;
+	const FIntPoint MinCell = GetCellForLocation(ViewLocation - FVector(QueryRadius));
+	const FIntPoint MaxCell = GetCellForLocation(ViewLocation + FVector(QueryRadius));
+
+	bool bFoundCandidate = false;
+
+	for (int32 X = MinCell.X; X <= MaxCell.X; ++X)
+	{
+		for (int32 Y = MinCell.Y; Y <= MaxCell.Y; ++Y)
+		{
+			const TArray<UInteractionComponent*>* CellInteractables = Cells.Find(FIntPoint(X, Y));
+			if (!CellInteractables)
+			{
+				continue;
+			}
+
+			for (UInteractionComponent* Interactable : *CellInteractables)
+			{
+				if (!Interactable->IsActive() || Interactable->GetOwner() == IgnoredActor)
+				{
+					continue;
+				}
+
+				//The trace can only hit the interactable if the view ray passes through its bounds
+				const FBoxSphereBounds Bounds = Interactable->GetInteractionBounds();
+				const float CandidateRadius = Bounds.SphereRadius + CandidateMargin;
+				const float AlongRay = FMath::Clamp(FVector::DotProduct(Bounds.Origin - ViewLocation, ViewDirection), 0.f, MaxDistance);
+
+				if (FVector::DistSquared(ViewLocation + ViewDirection * AlongRay, Bounds.Origin) <= FMath::Square(CandidateRadius))
+				{
+					bFoundCandidate = true;
+					if (!OutCandidates)
+					{
+						return true;
+					}
+					OutCandidates->Add(Interactable);
+				}
+			}
+		}
+	}
+	return bFoundCandidate;
+}
+
+ETickableTickType UInteractionSubsystem::GetTickableTickType() const
+{
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+bool UInteractionSubsystem::IsTickable() const
+{
+	return bInitialized && (PendingChecks.Num() > 0 || ScheduledInteractions.Num() > 0);
+}
+
+TStatId UInteractionSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UInteractionSubsystem, STATGROUP_Tickables);
+}
+
+void UInteractionSubsystem::RequestInteractionCheck(ASurvivalCharacter* Character, const bool bBeginInteract)
+{
+	if (!Character)
+	{
+		return;
+	}
+
+	FPendingInteractionCheck* Check = PendingChecks.FindByPredicate([Character](const FPendingInteractionCheck& Pending) { return Pending.Character == Character; });
+	if (!Check)
+	{
+		Check = &PendingChecks.AddDefaulted_GetRef();
+		Check->Character = Character;
+	}
+
+	//Pressed again before the check ran, the player is holding once more
+	if (bBeginInteract)
+	{
+		Check->bBeginInteract = true;
+		Check->bEndInteract = false;
+		Check->PredictionKey = Character->GetInteractPredictionKey();
+	}
+}
+
+bool UInteractionSubsystem::DeferEndInteract(ASurvivalCharacter* Character)
+{
+	bool bDeferred = false;
+	for (FPendingInteractionCheck& Check : PendingChecks)
+	{
+		if (Check.Character == Character && Check.bBeginInteract)
+		{
+			Check.bEndInteract = true;
+			bDeferred = true;
+		}
+	}
+	for (auto& InFlightCheck : InFlightChecks)
+	{
+		if (InFlightCheck.Value.Character == Character && InFlightCheck.Value.bBeginInteract && !InFlightCheck.Value.bEndInteract)
+		{
+			InFlightCheck.Value.bEndInteract = true;
+			bDeferred = true;
+		}
+	}
+	return bDeferred;
+}
+
+void UInteractionSubsystem::Tick(float DeltaTime)
+{
+	UWorld* World = GetWorld();
+	if (!World)
+	{
+		return;
+	}
+
+	FireDueInteractions();
+
+	//Swap out first, completing a check can queue a new one
+	TArray<FPendingInteractionCheck> ChecksToTrace = MoveTemp(PendingChecks);
+	PendingChecks.Reset();
+
+	for (FPendingInteractionCheck& Check : ChecksToTrace)
+	{
+		ASurvivalCharacter* Character = Check.Character.Get();
+		FVector TraceEnd;
+		if (!Character || !Character->GetInteractionTrace(Check.TraceStart, TraceEnd))
+		{
+			//Nothing to begin without a trace, but a release still has to end the interaction
+			if (Character && Check.bEndInteract)
+			{
+				Character->FinishEndInteract(Check.PredictionKey);
+			}
+			continue;
+		}
+
+		const FVector TraceDirection = (TraceEnd - Check.TraceStart).GetSafeNormal();
+		if (!FindCandidatesInView(Check.TraceStart, TraceDirection, FVector::Dist(Check.TraceStart, TraceEnd), Character))
+		{
+			CompleteInteractionCheck(Check, nullptr);
+			continue;
+		}
+
+		FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(InteractionCheck), false, Character);
+
+		const uint32 TraceId = NextTraceId++;
+		InFlightChecks.Add(TraceId, Check);
+		World->AsyncLineTraceByChannel(EAsyncTraceType::Single, Check.TraceStart, TraceEnd, ECC_Visibility, QueryParams, FCollisionResponseParams::DefaultResponseParam, &InteractionTraceDelegate, TraceId);
+	}
+}
+
+void UInteractionSubsystem::OnInteractionTraceCompleted(const FTraceHandle& TraceHandle, FTraceDatum& TraceDatum)
+{
+	FPendingInteractionCheck Check;
+	if (InFlightChecks.RemoveAndCopyValue(TraceDatum.UserData, Check))
+	{
+		const FHitResult* Hit = TraceDatum.OutHits.Num() && TraceDatum.OutHits[0].bBlockingHit ? &TraceDatum.OutHits[0] : nullptr;
+		CompleteInteractionCheck(Check, Hit);
+	}
+}
+
+void UInteractionSubsystem::CompleteInteractionCheck(const FPendingInteractionCheck& Check, const FHitResult* Hit)
+{
+	if (ASurvivalCharacter* Character = Check.Character.Get())
+	{
+		Character->ProcessInteractionHit(Hit, Check.TraceStart);
+
+		if (Check.bBeginInteract)
+		{
+			Character->FinishBeginInteract();
+
+			if (Check.bEndInteract)
+			{
+				Character->FinishEndInteract(Check.PredictionKey);
+			}
+		}
+	}
+}
+
+FInteractionHandle UInteractionSubsystem::ScheduleInteraction(ASurvivalCharacter* Character, const float Delay)
+{
+	FInteractionHandle Handle;
+	if (!Character || !GetWorld())
+	{
+		return Handle;
+	}
+
+	//Zero is the invalid id
+	if (++NextInteractionId == 0)
+	{
+		++NextInteractionId;
+	}
+	Handle.Id = NextInteractionId;
+
+	FScheduledInteraction& Scheduled = ScheduledInteractions.AddDefaulted_GetRef();
+	Scheduled.FireTime = GetWorld()->GetTimeSeconds() + Delay;
+	Scheduled.Id = Handle.Id;
+	Scheduled.Character = Character;
+
+	const int32 Index = ScheduledInteractions.Num() - 1;
+	ScheduledInteractionIndices.Add(Handle.Id, Index);
+	SiftUpScheduledInteraction(Index);
+
+	return Handle;
+}
+
+void UInteractionSubsystem::CancelInteraction(FInteractionHandle& Handle)
+{
+	if (const int32* Index = ScheduledInteractionIndices.Find(Handle.Id))
+	{
+		RemoveScheduledInteractionAt(*Index);
+	}
+	Handle.Invalidate();
+}
+
+bool UInteractionSubsystem::IsInteractionScheduled(const FInteractionHandle& Handle) const
+{
+	return Handle.IsValid() && ScheduledInteractionIndices.Contains(Handle.Id);
+}
+
+float UInteractionSubsystem::GetInteractionTimeRemaining(const FInteractionHandle& Handle) const
+{
+	const int32* Index = Handle.IsValid() ? ScheduledInteractionIndices.Find(Handle.Id) : nullptr;
+	if (Index && GetWorld())
+	{
+		return FMath::Max(ScheduledInteractions[*Index].FireTime - GetWorld()->GetTimeSeconds(), 0.f);
+	}
+	return -1.f;
+}
+
+void UInteractionSubsystem::FireDueInteractions()
+{
+	if (ScheduledInteractions.Num() == 0)
+	{
+		return;
+	}
+
+	const float Now = GetWorld()->GetTimeSeconds();
+
+	//Pop everything due before calling out, Interact can schedule or cancel interactions
+	TArray<TWeakObjectPtr<ASurvivalCharacter>, TInlineAllocator<8>> DueCharacters;
+	while (ScheduledInteractions.Num() && ScheduledInteractions[0].FireTime <= Now)
+	{
+		DueCharacters.Add(ScheduledInteractions[0].Character);
+		RemoveScheduledInteractionAt(0);
+	}
+
+	for (const TWeakObjectPtr<ASurvivalCharacter>& DueCharacter : DueCharacters)
+	{
+		if (ASurvivalCharacter* Character = DueCharacter.Get())
+		{
+			Character->Interact();
+		}
+	}
+}
+
+void UInteractionSubsystem::SiftUpScheduledInteraction(int32 Index)
+{
+	while (Index > 0)
+	{
+		const int32 Parent = (Index - 1) / 2;
+		if (ScheduledInteractions[Parent].FireTime <= ScheduledInteractions[Index].FireTime)
+		{
+			break;
+		}
+		SwapScheduledInteractions(Parent, Index);
+		Index = Parent;
+	}
+}
+
+void UInteractionSubsystem::SiftDownScheduledInteraction(int32 Index)
+{
+	const int32 Num = ScheduledInteractions.Num();
+	while (true)
+	{
+		const int32 Left = Index * 2 + 1;
+		const int32 Right = Left + 1;
+		int32 Smallest = Index;
+
+		if (Left < Num && ScheduledInteractions[Left].FireTime < ScheduledInteractions[Smallest].FireTime)
+		{
+			Smallest = Left;
+		}
+		if (Right < Num && ScheduledInteractions[Right].FireTime < ScheduledInteractions[Smallest].FireTime)
+		{
+			Smallest = Right;
+		}
+		if (Smallest == Index)
+		{
+			break;
+		}
+		SwapScheduledInteractions(Index, Smallest);
+		Index = Smallest;
+	}
+}
+
+void UInteractionSubsystem::SwapScheduledInteractions(const int32 A, const int32 B)
+{
+	ScheduledInteractions.Swap(A, B);
+	ScheduledInteractionIndices.Add(ScheduledInteractions[A].Id, A);
+	ScheduledInteractionIndices.Add(ScheduledInteractions[B].Id, B);
+}
+
+void UInteractionSubsystem::RemoveScheduledInteractionAt(const int32 Index)
+{
+	ScheduledInteractionIndices.Remove(ScheduledInteractions[Index].Id);
+
+	const int32 LastIndex = ScheduledInteractions.Num() - 1;
+	if (Index != LastIndex)
+	{
+		ScheduledInteractions[Index] = ScheduledInteractions[LastIndex];
+		ScheduledInteractionIndices.Add(ScheduledInteractions[Index].Id, Index);
+	}
+	ScheduledInteractions.Pop(false);
+
+	//The entry moved into the hole can belong either above or below it
+	if (Index < ScheduledInteractions.Num())
+	{
+		SiftUpScheduledInteraction(Index);
+		SiftDownScheduledInteraction(Index);
+	}
+}
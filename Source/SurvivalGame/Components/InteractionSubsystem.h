@@ -0,0 +1,150 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "WorldCollision.h"
+#include "InteractionSubsystem.generated.h"
+
+class UInteractionComponent;
+class ASurvivalCharacter;
+
+//An interaction check the server still has to trace for
+struct FPendingInteractionCheck
+{
+	FPendingInteractionCheck() : bBeginInteract(false), bEndInteract(false), PredictionKey(0), TraceStart(FVector::ZeroVector) {};
+
+	TWeakObjectPtr<ASurvivalCharacter> Character;
+
+	//Finish beginning the interaction once the result is known
+	bool bBeginInteract;
+
+	//The player let go before the result came back, end the interaction right after beginning it
+	bool bEndInteract;
+
+	//Interact prediction key of the begin, only its end may roll back the prediction
+	int32 PredictionKey;
+
+	FVector TraceStart;
+};
+
+//Identifies a hold interaction scheduled with the interaction subsystem
+struct FInteractionHandle
+{
+	FInteractionHandle() : Id(0) {};
+
+	bool IsValid() const { return Id != 0; }
+	void Invalidate() { Id = 0; }
+
+	uint32 Id;
+};
+
+//A hold interaction waiting to complete, kept in a min heap ordered by FireTime
+struct FScheduledInteraction
+{
+	FScheduledInteraction() : FireTime(0.f), Id(0) {};
+
+	float FireTime;
+	uint32 Id;
+	TWeakObjectPtr<ASurvivalCharacter> Character;
+};
+
+/**
+ * Keeps every registered interaction component in a uniform grid over the XY plane, so interaction
+ * checks can find out whether anything interactable is in front of the player before tracing.
+ * On the server it also gathers every player's interaction check for the frame and traces them
+ * as one batch of async traces, handing the results back to the characters next frame.
+ * Hold interactions of every character are scheduled here as well, and completed together each tick.
+ */
+UCLASS()
+class SURVIVALGAME_API UInteractionSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+
+	UInteractionSubsystem();
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+
+	/**Queues a server side interaction check for the character, traced with everyone else's at the end of the frame.
+	With bBeginInteract the character finishes beginning the interaction once the result is in.*/
+	void RequestInteractionCheck(ASurvivalCharacter* Character, const bool bBeginInteract);
+	/**Called when the character lets go. If a begin is still waiting on its check, the interaction is begun and then ended
+	once the check comes back and true is returned. Returns false if there is nothing to wait for.*/
+	bool DeferEndInteract(ASurvivalCharacter* Character);
+
+	//Calls Interact on the character once Delay seconds have passed, the handle is invalid if nothing got scheduled
+	FInteractionHandle ScheduleInteraction(ASurvivalCharacter* Character, const float Delay);
+	//Removes the scheduled interaction if it hasn't completed yet and invalidates the handle
+	void CancelInteraction(FInteractionHandle& Handle);
+	bool IsInteractionScheduled(const FInteractionHandle& Handle) const;
+	//Seconds until the interaction completes, -1 if it isn't scheduled
+	float GetInteractionTimeRemaining(const FInteractionHandle& Handle) const;
+
+	void RegisterInteractable(UInteractionComponent* Interactable);
+	void UnregisterInteractable(UInteractionComponent* Interactable);
+	//Moves the interactable to the grid cell of its current location if it changed cells
+	void UpdateInteractable(UInteractionComponent* Interactable);
+
+	/**Finds active interactables whose bounds the view ray passes through within MaxDistance.
+	Returns true as soon as one is found when OutCandidates is null.*/
+	bool FindCandidatesInView(const FVector& ViewLocation, const FVector& ViewDirection, const float MaxDistance, const AActor* IgnoredActor, TArray<UInteractionComponent*>* OutCandidates = nullptr) const;
+
+	//The interaction component an actor published when it registered, resolves trace hits without searching the actor's components
+	UInteractionComponent* FindInteractableForActor(const AActor* Actor) const;
+
+protected:
+
+	FIntPoint GetCellForLocation(const FVector& Location) const;
+
+	void OnInteractionTraceCompleted(const FTraceHandle& TraceHandle, FTraceDatum& TraceDatum);
+	void CompleteInteractionCheck(const FPendingInteractionCheck& Check, const FHitResult* Hit);
+
+	bool bInitialized;
+
+	//Checks requested this frame, one per character
+	TArray<FPendingInteractionCheck> PendingChecks;
+
+	//Checks with a trace in flight, keyed by the trace user data
+	TMap<uint32, FPendingInteractionCheck> InFlightChecks;
+	uint32 NextTraceId;
+
+	FTraceDelegate InteractionTraceDelegate;
+
+	//Completes every scheduled interaction that is due
+	void FireDueInteractions();
+
+	//Heap helpers, they keep ScheduledInteractionIndices up to date as entries move
+	void SiftUpScheduledInteraction(int32 Index);
+	void SiftDownScheduledInteraction(int32 Index);
+	void SwapScheduledInteractions(const int32 A, const int32 B);
+	void RemoveScheduledInteractionAt(const int32 Index);
+
+	TArray<FScheduledInteraction> ScheduledInteractions;
+	//Where each scheduled interaction currently sits in the heap, by id
+	TMap<uint32, int32> ScheduledInteractionIndices;
+	uint32 NextInteractionId;
+
+	//Size of a grid cell in world units
+	float CellSize;
+
+	//Extra radius added around interactable bounds, the trace may hit parts of the actor outside the parent bounds
+	float CandidateMargin;
+
+	//Largest bounds radius registered so far, queries are widened by it so big interactables in neighbouring cells aren't missed
+	float MaxCandidateRadius;
+
+	//Components always unregister before they are destroyed, so these don't need to keep them alive
+	TMap<FIntPoint, TArray<UInteractionComponent*>> Cells;
+	TMap<UInteractionComponent*, FIntPoint> InteractableCells;
+	TMap<const AActor*, UInteractionComponent*> InteractablesByActor;
+};
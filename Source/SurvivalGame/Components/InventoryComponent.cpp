@@ -4,13 +4,42 @@
 #include "InventoryComponent.h"
 #include "Net/UnrealNetwork.h"
 #include "Engine/ActorChannel.h"
+#include "HAL/IConsoleManager.h"
+#include "Items/ItemPoolSubsystem.h"
 
 #define LOCTEXT_NAMESPACE "Inventory"
 
+static const int32 MaxRecentPredictionResults = 8;
+
+#if !UE_BUILD_SHIPPING
+static TAutoConsoleVariable<int32> CVarValidateInventoryAggregates(
+	TEXT("SurvivalGame.ValidateInventoryAggregates"),
+	UE_BUILD_DEBUG ? 1 : 0,
+	TEXT("Recounts inventory weight, item count and class indices after every change and ensures they match the cached totals. On by default only in Debug builds"));
+#endif
+
 // Sets default values for this component's properties
 UInventoryComponent::UInventoryComponent()
 {	
 	SetIsReplicatedByDefault(true);
+
+	CurrentWeight = 0.0f;
+	CurrentItemCount = 0;
+
+	bClientCachesDirty = false;
+	bInventoryUpdatePending = false;
+
+	BatchDepth = 0;
+	bBatchModifiedItems = false;
+	bBatchNeedsClientRefresh = false;
+
+	bUseCompactStorage = false;
+
+	PredictedWeight = 0.f;
+	PredictedItemCount = 0;
+	PredictedSlotCount = 0;
+
+	InventoryItems.OwnerComponent = this;
 }
 
 FItemAddResult UInventoryComponent::TryAddItem(class UItem* Item)
@@ -20,9 +49,17 @@ FItemAddResult UInventoryComponent::TryAddItem(class UItem* Item)
 
 FItemAddResult UInventoryComponent::TryAddItemFromClass(TSubclassOf<class UItem> ItemClass, const int32 Quantity)
 {
-	UItem* Item = NewObject<UItem>(GetOwner(), ItemClass);
+	UItem* Item = UItemPoolSubsystem::AcquireItem(GetWorld(), ItemClass, GetOwner());
+	if (!Item)
+	{
+		return FItemAddResult::AddedNone(Quantity, FText::GetEmpty());
+	}
 	Item->SetQuantity(Quantity);
-	return TryAddItem_Internal(Item);
+
+	//The temporary item only describes what to add, AddItem copies it into the inventory
+	const FItemAddResult AddResult = TryAddItem_Internal(Item);
+	UItemPoolSubsystem::ReleaseItemImmediate(GetWorld(), Item);
+	return AddResult;
 }
 
 int32 UInventoryComponent::ConsumeItem(class UItem* Item)
@@ -48,6 +85,10 @@ int32 UInventoryComponent::ConsumeItem(class UItem* Item, const int32 Quantity)
 		{
 			RemoveItem(Item);
 		}
+		else if (IsBatching())
+		{
+			bBatchNeedsClientRefresh = true;
+		}
 		else
 		{
 			RefreshClientInventory();
@@ -63,46 +104,154 @@ bool UInventoryComponent::RemoveItem(class UItem* Item)
 	{
 		if (Item)
 		{
-			Items_Array.RemoveSingle(Item);
-			OnRep_Items();
-			ReplicatedItemsKey++;
+			const int32 ItemIndex = FindItemIndex(Item);
+			if (ItemIndex != INDEX_NONE)
+			{
+				RemoveItemAt(ItemIndex);
+			}
+			else if (!IsBatching())
+			{
+				InventoryItems.MarkArrayDirty();
+				OnInventoryUpdated.Broadcast();
+				ReplicatedItemsKey++;
+			}
 			return true;
 		}
 	}
 	return false;
 }
 
-bool UInventoryComponent::HasItem(TSubclassOf<class UItem> ItemClass, const int32 Quantity /*= 1*/) const
+void UInventoryComponent::RemoveItemAt(const int32 Index)
 {
-	if (UItem* ItemToFind = FindItemByClass(ItemClass))
+	//Listeners get handed a UItem, so give compact entries their stand in before the entry goes away
+	if (OnItemRemoved.IsBound())
 	{
-		return ItemToFind->GetQuantity() >= Quantity;
+		GetItemAt(Index);
+	}
+
+	const FInventoryItemEntry RemovedEntry = InventoryItems.Entries[Index];
+
+	UnindexItemAt(Index);
+	InventoryItems.Entries.RemoveAt(Index);
+
+	CurrentWeight -= RemovedEntry.GetStackWeight();
+	CurrentItemCount -= RemovedEntry.GetQuantity();
+
+	ValidateAggregates();
+
+	BroadcastClassChanged(RemovedEntry.GetItemClass());
+
+	if (UItem* Item = RemovedEntry.GetItem())
+	{
+		Item->OwningInventoryComponent = nullptr;
+
+		OnItemRemoved.Broadcast(Item);
+
+		UItemPoolSubsystem::ReleaseItem(GetWorld(), Item);
+	}
+
+	if (IsBatching())
+	{
+		bBatchModifiedItems = true;
+	}
+	else
+	{
+		InventoryItems.MarkArrayDirty();
+		OnInventoryUpdated.Broadcast();
+		ReplicatedItemsKey++;
 	}
-	return false;
 }
 
-UItem* UInventoryComponent::FindItem(class UItem* Item) const
+void UInventoryComponent::RemoveAllItems()
 {
-	if (Item)
+	FInventoryBatchScope RemoveBatch(this);
+
+	for (int32 i = InventoryItems.Entries.Num() - 1; i >= 0; --i)
+	{
+		RemoveItemAt(i);
+	}
+}
+
+int32 UInventoryComponent::ConsumeItemsByClass(TSubclassOf<class UItem> ItemClass, const int32 Quantity)
+{
+	int32 ConsumedQuantity = 0;
+	if (GetOwner() && GetOwner()->HasAuthority() && ItemClass)
 	{
-		for (auto& invItem : Items_Array)
+		FInventoryBatchScope ConsumeBatch(this);
+
+		//Emptied stacks are removed from the index, so look the next one up each time
+		while (ConsumedQuantity < Quantity)
 		{
-			if (invItem && invItem->GetClass() == Item->GetClass())
+			const TArray<int32>* Indices = ItemIndicesByClass.Find(ItemClass);
+			if (!Indices || Indices->Num() == 0)
 			{
-				return invItem;
+				break;
 			}
+
+			const int32 Index = (*Indices)[0];
+			const FInventoryItemEntry& Entry = InventoryItems.Entries[Index];
+			int32 StackConsumed = 0;
+
+			if (Entry.IsCompact() && !Entry.LocalItem)
+			{
+				StackConsumed = FMath::Min(Entry.Quantity, Quantity - ConsumedQuantity);
+				if (StackConsumed >= Entry.Quantity)
+				{
+					RemoveItemAt(Index);
+				}
+				else
+				{
+					SetEntryQuantity(Index, Entry.Quantity - StackConsumed);
+					bBatchNeedsClientRefresh = true;
+				}
+			}
+			else if (UItem* Stack = Entry.GetItem())
+			{
+				StackConsumed = ConsumeItem(Stack, Quantity - ConsumedQuantity);
+			}
+
+			if (StackConsumed <= 0)
+			{
+				break;
+			}
+			ConsumedQuantity += StackConsumed;
 		}
 	}
+	return ConsumedQuantity;
+}
+
+bool UInventoryComponent::HasItem(TSubclassOf<class UItem> ItemClass, const int32 Quantity /*= 1*/) const
+{
+	return GetItemQuantityByClass(ItemClass) >= Quantity;
+}
+
+UItem* UInventoryComponent::FindItem(class UItem* Item) const
+{
+	if (Item)
+	{
+		RefreshClientCaches();
+
+		if (FindItemIndex(Item) != INDEX_NONE)
+		{
+			return Item;
+		}
+		return FindItemByClass(Item->GetClass());
+	}
 	return nullptr;
 }
 
 UItem* UInventoryComponent::FindItemByClass(TSubclassOf<class UItem> ItemClass) const
 {
-	for (auto& invItem : Items_Array)
+	RefreshClientCaches();
+
+	if (const TArray<int32>* Indices = ItemIndicesByClass.Find(ItemClass))
 	{
-		if (invItem && invItem->GetClass() == ItemClass)
+		for (const int32 Index : *Indices)
 		{
-			return invItem;
+			if (UItem* Item = InventoryItems.Entries[Index].GetItem())
+			{
+				return Item;
+			}
 		}
 	}
 	return nullptr;
@@ -110,28 +259,119 @@ UItem* UInventoryComponent::FindItemByClass(TSubclassOf<class UItem> ItemClass)
 
 TArray<UItem*> UInventoryComponent::FindItemsByClass(TSubclassOf<class UItem> ItemClass) const
 {
+	RefreshClientCaches();
+
 	TArray<UItem*> ItemsOfClass;
-	for (auto& invItem : Items_Array)
+	if (ItemClass)
 	{
-		if (invItem && invItem->GetClass()->IsChildOf(ItemClass))
+		for (UClass* HeldClass : GetHeldSubclassesOf(ItemClass))
 		{
-			ItemsOfClass.Add(invItem);
+			for (const int32 Index : ItemIndicesByClass.FindChecked(HeldClass))
+			{
+				if (UItem* Item = InventoryItems.Entries[Index].GetItem())
+				{
+					ItemsOfClass.Add(Item);
+				}
+			}
 		}
 	}
 	return ItemsOfClass;
 }
 
+UItem* UInventoryComponent::GetOrCreateItemObject(TSubclassOf<class UItem> ItemClass)
+{
+	RefreshClientCaches();
+
+	if (const TArray<int32>* Indices = ItemIndicesByClass.Find(ItemClass))
+	{
+		if (Indices->Num())
+		{
+			return GetItemAt((*Indices)[0]);
+		}
+	}
+	return nullptr;
+}
+
+int32 UInventoryComponent::GetItemQuantityByClass(TSubclassOf<class UItem> ItemClass) const
+{
+	RefreshClientCaches();
+
+	int32 Quantity = 0;
+	if (const TArray<int32>* Indices = ItemIndicesByClass.Find(ItemClass))
+	{
+		for (const int32 Index : *Indices)
+		{
+			Quantity += InventoryItems.Entries[Index].GetQuantity();
+		}
+	}
+	return Quantity;
+}
+
 float UInventoryComponent::GetCurrentWeight() const
 {
-	float Weight = 0.0f;
-	for (auto& Item : Items_Array)
+	RefreshClientCaches();
+	return CurrentWeight + PredictedWeight;
+}
+
+int32 UInventoryComponent::GetCurrentItemCount() const
+{
+	RefreshClientCaches();
+	return CurrentItemCount + PredictedItemCount;
+}
+
+TArray<UItem*> UInventoryComponent::GetItems() const
+{
+	TArray<UItem*> Items;
+	Items.Reserve(InventoryItems.Entries.Num() + PredictedAdds.Num());
+
+	for (const FInventoryItemEntry& Entry : InventoryItems.Entries)
 	{
-		if (Item)
+		if (UItem* Item = Entry.GetItem())
+		{
+			Items.Add(Item);
+		}
+	}
+	for (const FPredictedInventoryAdd& PredictedAdd : PredictedAdds)
+	{
+		if (PredictedAdd.Item)
+		{
+			Items.Add(PredictedAdd.Item);
+		}
+	}
+	return Items;
+}
+
+TArray<FInventoryStack> UInventoryComponent::GetStacks() const
+{
+	TArray<FInventoryStack> Stacks;
+	Stacks.Reserve(InventoryItems.Entries.Num() + PredictedAdds.Num());
+
+	for (const FInventoryItemEntry& Entry : InventoryItems.Entries)
+	{
+		if (UClass* ItemClass = Entry.GetItemClass())
+		{
+			Stacks.Emplace(ItemClass, Entry.GetQuantity(), Entry.GetItem());
+		}
+	}
+	for (const FPredictedInventoryAdd& PredictedAdd : PredictedAdds)
+	{
+		Stacks.Emplace(PredictedAdd.ItemClass, PredictedAdd.Quantity, PredictedAdd.Item);
+	}
+	return Stacks;
+}
+
+UItem* UInventoryComponent::GetItemOfStack(const int32 StackIndex)
+{
+	//Entries without a class are unmapped items GetStacks skipped, count them out the same way
+	int32 StacksLeft = StackIndex;
+	for (int32 i = 0; i < InventoryItems.Entries.Num(); ++i)
+	{
+		if (InventoryItems.Entries[i].GetItemClass() && StacksLeft-- == 0)
 		{
-			Weight += Item->GetStackWeight();
+			return GetItemAt(i);
 		}
 	}
-	return Weight;
+	return PredictedAdds.IsValidIndex(StacksLeft) ? PredictedAdds[StacksLeft].Item : nullptr;
 }
 
 void UInventoryComponent::SetWeightCapacity(const float NewWeightCapacity)
@@ -146,6 +386,160 @@ void UInventoryComponent::SetCapacity(const int32 NewCapacity)
 	OnInventoryUpdated.Broadcast();
 }
 
+int32 UInventoryComponent::GetAmountThatFits(TSubclassOf<class UItem> ItemClass, const int32 Quantity) const
+{
+	const UItem* ItemCDO = ItemClass ? ItemClass->GetDefaultObject<UItem>() : nullptr;
+	if (!ItemCDO || Quantity <= 0)
+	{
+		return 0;
+	}
+
+	int32 AmountLeft = Quantity;
+	if (!FMath::IsNearlyZero(ItemCDO->Weight))
+	{
+		AmountLeft = FMath::Clamp(FMath::FloorToInt((GetWeightCapacity() - GetCurrentWeight()) / ItemCDO->Weight), 0, Quantity);
+	}
+
+	const int32 MaxStackSize = ItemCDO->bStackable ? ItemCDO->MaxStackSize : 1;
+	int32 Space = 0;
+
+	if (ItemCDO->bStackable)
+	{
+		RefreshClientCaches();
+		if (const TArray<int32>* Indices = ItemIndicesByClass.Find(ItemClass))
+		{
+			for (const int32 Index : *Indices)
+			{
+				Space += FMath::Max(MaxStackSize - InventoryItems.Entries[Index].GetQuantity(), 0);
+			}
+		}
+	}
+
+	const int32 FreeSlots = FMath::Max(GetCapacity() - InventoryItems.Entries.Num() - PredictedSlotCount, 0);
+	Space += FreeSlots * MaxStackSize;
+
+	return FMath::Min(AmountLeft, Space);
+}
+
+int32 UInventoryComponent::PredictAddItem(const int32 PredictionKey, TSubclassOf<class UItem> ItemClass, const int32 Quantity, AActor* SourceActor /*= nullptr*/)
+{
+	if (!GetOwner() || GetOwner()->HasAuthority() || PredictionKey <= PredictionAck.PredictionKey)
+	{
+		return 0;
+	}
+
+	const int32 PredictedAmount = GetAmountThatFits(ItemClass, Quantity);
+	if (PredictedAmount <= 0)
+	{
+		return 0;
+	}
+
+	const UItem* ItemCDO = ItemClass->GetDefaultObject<UItem>();
+
+	FPredictedInventoryAdd& PredictedAdd = PredictedAdds.AddDefaulted_GetRef();
+	PredictedAdd.PredictionKey = PredictionKey;
+	PredictedAdd.ItemClass = ItemClass;
+	PredictedAdd.Quantity = PredictedAmount;
+
+	//Stands in for whatever stacks the server ends up with, proxies go through the by class RPCs if used
+	PredictedAdd.Item = UItemPoolSubsystem::AcquireItem(GetWorld(), ItemClass, GetOwner());
+	if (PredictedAdd.Item)
+	{
+		PredictedAdd.Item->World = GetWorld();
+		PredictedAdd.Item->bCompactProxy = true;
+		PredictedAdd.Item->Quantity = FMath::Min(PredictedAmount, ItemCDO->bStackable ? ItemCDO->MaxStackSize : 1);
+	}
+
+	if (SourceActor && PredictedAmount >= Quantity)
+	{
+		PredictedAdd.SourceActor = SourceActor;
+		SourceActor->SetActorHiddenInGame(true);
+		SourceActor->SetActorEnableCollision(false);
+	}
+
+	PredictedWeight += PredictedAmount * ItemCDO->Weight;
+	PredictedItemCount += PredictedAmount;
+	PredictedSlotCount += FMath::DivideAndRoundUp(PredictedAmount, ItemCDO->bStackable ? ItemCDO->MaxStackSize : 1);
+
+	OnInventoryUpdated.Broadcast();
+	return PredictedAmount;
+}
+
+void UInventoryComponent::AcknowledgePrediction(const int32 PredictionKey, const int32 AmountGiven)
+{
+	if (GetOwner() && GetOwner()->HasAuthority() && PredictionKey > PredictionAck.PredictionKey)
+	{
+		PredictionAck.PredictionKey = PredictionKey;
+		PredictionAck.RecentResults.Emplace(PredictionKey, AmountGiven);
+
+		//The client only needs the keys it may not have seen yet, a handful covers any acks that land in one net update
+		if (PredictionAck.RecentResults.Num() > MaxRecentPredictionResults)
+		{
+			PredictionAck.RecentResults.RemoveAt(0, PredictionAck.RecentResults.Num() - MaxRecentPredictionResults);
+		}
+	}
+}
+
+void UInventoryComponent::OnRep_PredictionAck()
+{
+	ResolvePredictions(PredictionAck);
+}
+
+void UInventoryComponent::ResolvePredictions(const FInventoryPredictionAck& Ack)
+{
+	bool bResolvedAny = false;
+
+	for (int32 i = PredictedAdds.Num() - 1; i >= 0; --i)
+	{
+		FPredictedInventoryAdd& PredictedAdd = PredictedAdds[i];
+		if (PredictedAdd.PredictionKey > Ack.PredictionKey)
+		{
+			continue;
+		}
+
+		//Keys the server never answered were dropped, only keys with a result of their own can have been taken in full
+		const FInventoryPredictionResult* Result = Ack.RecentResults.FindByPredicate([&PredictedAdd](const FInventoryPredictionResult& RecentResult) { return RecentResult.PredictionKey == PredictedAdd.PredictionKey; });
+		const bool bTakenInFull = Result && Result->AmountGiven >= PredictedAdd.Quantity;
+		if (AActor* SourceActor = PredictedAdd.SourceActor.Get())
+		{
+			if (!bTakenInFull)
+			{
+				SourceActor->SetActorHiddenInGame(false);
+				SourceActor->SetActorEnableCollision(true);
+			}
+		}
+
+		if (PredictedAdd.Item)
+		{
+			UItemPoolSubsystem::ReleaseItem(GetWorld(), PredictedAdd.Item);
+		}
+
+		PredictedAdds.RemoveAt(i, 1, false);
+		bResolvedAny = true;
+	}
+
+	if (bResolvedAny)
+	{
+		PredictedWeight = 0.f;
+		PredictedItemCount = 0;
+		PredictedSlotCount = 0;
+		for (const FPredictedInventoryAdd& PredictedAdd : PredictedAdds)
+		{
+			const UItem* ItemCDO = PredictedAdd.ItemClass->GetDefaultObject<UItem>();
+			PredictedWeight += PredictedAdd.Quantity * ItemCDO->Weight;
+			PredictedItemCount += PredictedAdd.Quantity;
+			PredictedSlotCount += FMath::DivideAndRoundUp(PredictedAdd.Quantity, ItemCDO->bStackable ? ItemCDO->MaxStackSize : 1);
+		}
+
+		OnInventoryUpdated.Broadcast();
+	}
+}
+
+void UInventoryComponent::SetUseCompactStorage(const bool bNewUseCompactStorage)
+{
+	bUseCompactStorage = bNewUseCompactStorage;
+}
+
 void UInventoryComponent::RefreshClientInventory_Implementation()
 {
 	OnInventoryUpdated.Broadcast();
@@ -158,24 +552,425 @@ void UInventoryComponent::BeginPlay()
 		
 }
 
-void UInventoryComponent::OnRep_Items()
+void FInventoryItemEntry::PreReplicatedRemove(const FInventoryItemList& InArraySerializer)
+{
+	if (InArraySerializer.OwnerComponent)
+	{
+		InArraySerializer.OwnerComponent->OnEntryReplicatedRemove(*this);
+	}
+}
+
+void FInventoryItemEntry::PostReplicatedAdd(const FInventoryItemList& InArraySerializer)
+{
+	if (InArraySerializer.OwnerComponent)
+	{
+		InArraySerializer.OwnerComponent->OnEntryReplicatedAdd(*this);
+	}
+}
+
+void FInventoryItemEntry::PostReplicatedChange(const FInventoryItemList& InArraySerializer)
+{
+	if (InArraySerializer.OwnerComponent)
+	{
+		InArraySerializer.OwnerComponent->OnEntryReplicatedChange(*this);
+	}
+}
+
+void UInventoryComponent::OnEntryReplicatedAdd(FInventoryItemEntry& Entry)
+{
+	MarkClientCachesDirty();
+	BroadcastClassChanged(Entry.GetItemClass());
+
+	if (Entry.IsCompact())
+	{
+		if (OnItemAdded.IsBound())
+		{
+			OnItemAdded.Broadcast(MaterializeCompactItem(Entry));
+		}
+	}
+	//The item pointer may not be mapped yet, in which case it shows up later as a change
+	else if (UItem* Item = Entry.Item)
+	{
+		Item->World = GetWorld();
+		Item->OwningInventoryComponent = this;
+		OnItemAdded.Broadcast(Item);
+	}
+}
+
+void UInventoryComponent::OnEntryReplicatedChange(FInventoryItemEntry& Entry)
 {
+	MarkClientCachesDirty();
+	BroadcastClassChanged(Entry.GetItemClass());
+
+	if (Entry.IsCompact())
+	{
+		if (UItem* LocalItem = Entry.LocalItem)
+		{
+			LocalItem->Quantity = Entry.Quantity;
+			LocalItem->OnItemModified.Broadcast();
+			OnItemChanged.Broadcast(LocalItem);
+		}
+		else if (OnItemChanged.IsBound())
+		{
+			OnItemChanged.Broadcast(MaterializeCompactItem(Entry));
+		}
+	}
+	else if (UItem* Item = Entry.Item)
+	{
+		Item->World = GetWorld();
+		Item->OwningInventoryComponent = this;
+		OnItemChanged.Broadcast(Item);
+	}
+}
+
+void UInventoryComponent::OnEntryReplicatedRemove(FInventoryItemEntry& Entry)
+{
+	MarkClientCachesDirty();
+	BroadcastClassChanged(Entry.GetItemClass());
+
+	if (UItem* Item = Entry.GetItem())
+	{
+		if (Item->OwningInventoryComponent == this)
+		{
+			Item->OwningInventoryComponent = nullptr;
+		}
+		OnItemRemoved.Broadcast(Item);
+	}
+
+	//The stand in only ever lived on this client, hand it back to the pool with its entry
+	if (Entry.IsCompact() && Entry.LocalItem)
+	{
+		UItemPoolSubsystem::ReleaseItem(GetWorld(), Entry.LocalItem);
+		Entry.LocalItem = nullptr;
+	}
+}
+
+UItem* UInventoryComponent::GetItemAt(const int32 Index)
+{
+	FInventoryItemEntry& Entry = InventoryItems.Entries[Index];
+	if (Entry.IsCompact())
+	{
+		return MaterializeCompactItem(Entry);
+	}
+	return Entry.Item;
+}
+
+UItem* UInventoryComponent::MaterializeCompactItem(FInventoryItemEntry& Entry)
+{
+	if (!Entry.LocalItem && Entry.ItemClass)
+	{
+		UItem* LocalItem = UItemPoolSubsystem::AcquireItem(GetWorld(), Entry.ItemClass, GetOwner());
+		LocalItem->World = GetWorld();
+		LocalItem->Quantity = Entry.Quantity;
+		LocalItem->OwningInventoryComponent = this;
+		LocalItem->bCompactProxy = true;
+
+		Entry.LocalItem = LocalItem;
+	}
+	return Entry.LocalItem;
+}
+
+void UInventoryComponent::SetEntryQuantity(const int32 Index, const int32 NewQuantity)
+{
+	FInventoryItemEntry& Entry = InventoryItems.Entries[Index];
+	if (!Entry.IsCompact())
+	{
+		if (Entry.Item)
+		{
+			Entry.Item->SetQuantity(NewQuantity);
+		}
+		return;
+	}
+
+	const UItem* ItemDefaults = Entry.ItemClass->GetDefaultObject<UItem>();
+	const int32 OldQuantity = Entry.Quantity;
+	Entry.Quantity = FMath::Clamp(NewQuantity, 0, ItemDefaults->MaxStackSize);
+
+	if (Entry.Quantity != OldQuantity)
+	{
+		const int32 QuantityDelta = Entry.Quantity - OldQuantity;
+		CurrentItemCount += QuantityDelta;
+		CurrentWeight += QuantityDelta * ItemDefaults->Weight;
+		ValidateAggregates();
+
+		BroadcastClassChanged(Entry.ItemClass);
+
+		//Compact entries only replicate through the array, so they are always marked dirty straight away
+		InventoryItems.MarkItemDirty(Entry);
+
+		if (IsBatching())
+		{
+			bBatchModifiedItems = true;
+		}
+
+		if (UItem* LocalItem = Entry.LocalItem)
+		{
+			LocalItem->Quantity = Entry.Quantity;
+			LocalItem->OnItemModified.Broadcast();
+		}
+		if (OnItemChanged.IsBound())
+		{
+			OnItemChanged.Broadcast(GetItemAt(Index));
+		}
+	}
+}
+
+void UInventoryComponent::MarkClientCachesDirty()
+{
+	bClientCachesDirty = true;
+
+	//A single replication update can touch many entries, only tell the UI once
+	if (!bInventoryUpdatePending && GetWorld())
+	{
+		bInventoryUpdatePending = true;
+		GetWorld()->GetTimerManager().SetTimerForNextTick(this, &UInventoryComponent::BroadcastInventoryUpdated);
+	}
+}
+
+void UInventoryComponent::RefreshClientCaches() const
+{
+	if (bClientCachesDirty)
+	{
+		bClientCachesDirty = false;
+
+		UInventoryComponent* MutableThis = const_cast<UInventoryComponent*>(this);
+		MutableThis->RecalculateAggregates();
+		MutableThis->RebuildItemIndex();
+	}
+}
+
+void UInventoryComponent::BroadcastInventoryUpdated()
+{
+	bInventoryUpdatePending = false;
 	OnInventoryUpdated.Broadcast();
+}
 
-	for (auto& NItem : Items_Array)
+void UInventoryComponent::BroadcastClassChanged(UClass* ItemClass)
+{
+	if (ItemClass)
 	{
-		if (NItem && !NItem->World)
+		OnClassChanged.Broadcast(ItemClass);
+	}
+}
+
+void UInventoryComponent::OnItemQuantityChanged(class UItem* Item, const int32 OldQuantity)
+{
+	if (Item)
+	{
+		//Stand ins of compact entries write their quantity back into the entry, which is what replicates
+		if (Item->bCompactProxy && GetOwner() && GetOwner()->HasAuthority())
+		{
+			const int32 ItemIndex = FindItemIndex(Item);
+			if (ItemIndex != INDEX_NONE)
+			{
+				FInventoryItemEntry& Entry = InventoryItems.Entries[ItemIndex];
+				Entry.Quantity = Item->GetQuantity();
+				InventoryItems.MarkItemDirty(Entry);
+			}
+		}
+
+		//A pending rebuild picks the new quantity up anyway
+		if (!bClientCachesDirty)
 		{
-			NItem->World = GetWorld();
+			const int32 QuantityDelta = Item->GetQuantity() - OldQuantity;
+
+			CurrentItemCount += QuantityDelta;
+			CurrentWeight += QuantityDelta * Item->Weight;
+
+			ValidateAggregates();
+		}
+		BroadcastClassChanged(Item->GetClass());
+		OnItemChanged.Broadcast(Item);
+	}
+}
+
+void UInventoryComponent::RecalculateAggregates()
+{
+	CurrentWeight = 0.0f;
+	CurrentItemCount = 0;
+
+	for (const FInventoryItemEntry& Entry : InventoryItems.Entries)
+	{
+		if (Entry.GetItemClass())
+		{
+			CurrentWeight += Entry.GetStackWeight();
+			CurrentItemCount += Entry.GetQuantity();
+		}
+	}
+}
+
+void UInventoryComponent::ValidateAggregates() const
+{
+#if !UE_BUILD_SHIPPING
+	if (CVarValidateInventoryAggregates.GetValueOnGameThread() == 0)
+	{
+		return;
+	}
+
+	float RecomputedWeight = 0.0f;
+	int32 RecomputedItemCount = 0;
+
+	int32 HeldItems = 0;
+
+	for (const FInventoryItemEntry& Entry : InventoryItems.Entries)
+	{
+		if (Entry.GetItemClass())
+		{
+			RecomputedWeight += Entry.GetStackWeight();
+			RecomputedItemCount += Entry.GetQuantity();
+			++HeldItems;
+		}
+	}
+
+	ensureMsgf(RecomputedItemCount == CurrentItemCount, TEXT("%s item count out of sync, cached %d actual %d"), *GetName(), CurrentItemCount, RecomputedItemCount);
+	ensureMsgf(FMath::IsNearlyEqual(RecomputedWeight, CurrentWeight, 0.01f), TEXT("%s weight out of sync, cached %f actual %f"), *GetName(), CurrentWeight, RecomputedWeight);
+
+	int32 IndexedItems = 0;
+	for (auto& ClassIndices : ItemIndicesByClass)
+	{
+		for (const int32 Index : ClassIndices.Value)
+		{
+			ensureMsgf(InventoryItems.Entries.IsValidIndex(Index) && InventoryItems.Entries[Index].GetItemClass() == ClassIndices.Key, TEXT("%s class index is stale"), *GetName());
+		}
+		IndexedItems += ClassIndices.Value.Num();
+	}
+
+	ensureMsgf(IndexedItems == HeldItems, TEXT("%s class index holds %d items, inventory has %d"), *GetName(), IndexedItems, HeldItems);
+#endif
+}
+
+void UInventoryComponent::IndexItemAt(const int32 Index)
+{
+	if (UClass* ItemClass = InventoryItems.Entries[Index].GetItemClass())
+	{
+		TArray<int32>& Indices = ItemIndicesByClass.FindOrAdd(ItemClass);
+		if (Indices.Num() == 0)
+		{
+			SubclassQueryCache.Reset();
+		}
+		Indices.Add(Index);
+	}
+}
+
+void UInventoryComponent::UnindexItemAt(const int32 Index)
+{
+	if (UClass* ItemClass = InventoryItems.Entries[Index].GetItemClass())
+	{
+		if (TArray<int32>* Indices = ItemIndicesByClass.Find(ItemClass))
+		{
+			Indices->Remove(Index);
+			if (Indices->Num() == 0)
+			{
+				ItemIndicesByClass.Remove(ItemClass);
+				SubclassQueryCache.Reset();
+			}
+		}
+	}
+
+	//Everything after the removed slot shifts down by one
+	for (auto& ClassIndices : ItemIndicesByClass)
+	{
+		for (int32& OtherIndex : ClassIndices.Value)
+		{
+			if (OtherIndex > Index)
+			{
+				--OtherIndex;
+			}
+		}
+	}
+}
+
+void UInventoryComponent::RebuildItemIndex()
+{
+	ItemIndicesByClass.Reset();
+	SubclassQueryCache.Reset();
+
+	for (int32 i = 0; i < InventoryItems.Entries.Num(); ++i)
+	{
+		IndexItemAt(i);
+	}
+}
+
+int32 UInventoryComponent::FindItemIndex(const class UItem* Item) const
+{
+	if (Item)
+	{
+		if (const TArray<int32>* Indices = ItemIndicesByClass.Find(Item->GetClass()))
+		{
+			for (const int32 Index : *Indices)
+			{
+				if (InventoryItems.Entries[Index].GetItem() == Item)
+				{
+					return Index;
+				}
+			}
 		}
 	}
+	return INDEX_NONE;
+}
+
+const TArray<UClass*>& UInventoryComponent::GetHeldSubclassesOf(UClass* Class) const
+{
+	if (const TArray<UClass*>* Cached = SubclassQueryCache.Find(Class))
+	{
+		return *Cached;
+	}
+
+	TArray<UClass*>& HeldSubclasses = SubclassQueryCache.Add(Class);
+	for (auto& ClassIndices : ItemIndicesByClass)
+	{
+		if (ClassIndices.Key->IsChildOf(Class))
+		{
+			HeldSubclasses.Add(ClassIndices.Key);
+		}
+	}
+	return HeldSubclasses;
+}
+
+void UInventoryComponent::MarkItemsDirty()
+{
+	if (IsBatching())
+	{
+		bBatchModifiedItems = true;
+	}
+	else
+	{
+		++ReplicatedItemsKey;
+	}
+}
+
+void UInventoryComponent::BeginBatch()
+{
+	++BatchDepth;
+}
+
+void UInventoryComponent::EndBatch()
+{
+	check(BatchDepth > 0);
+
+	if (--BatchDepth == 0)
+	{
+		if (bBatchModifiedItems)
+		{
+			InventoryItems.MarkArrayDirty();
+			++ReplicatedItemsKey;
+			OnInventoryUpdated.Broadcast();
+		}
+		if (bBatchNeedsClientRefresh)
+		{
+			RefreshClientInventory();
+		}
+		bBatchModifiedItems = false;
+		bBatchNeedsClientRefresh = false;
+	}
 }
 
 void UInventoryComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
-	DOREPLIFETIME(UInventoryComponent, Items_Array);
+	DOREPLIFETIME(UInventoryComponent, InventoryItems);
+	DOREPLIFETIME_CONDITION(UInventoryComponent, PredictionAck, COND_OwnerOnly);
 }
 
 bool UInventoryComponent::ReplicateSubobjects(class UActorChannel* Channel, class FOutBunch* Bunch, FReplicationFlags* RepFlags)
@@ -184,9 +979,10 @@ bool UInventoryComponent::ReplicateSubobjects(class UActorChannel* Channel, clas
 
 	if (Channel->KeyNeedsToReplicate(0, ReplicatedItemsKey))
 	{
-		for (auto& Item : Items_Array)
+		for (const FInventoryItemEntry& Entry : InventoryItems.Entries)
 		{
-			if (Channel->KeyNeedsToReplicate(Item->GetUniqueID(), Item->RepKey))
+			UItem* Item = Entry.Item;
+			if (Item && Channel->KeyNeedsToReplicate(Item->GetUniqueID(), Item->RepKey))
 			{
 				bWroteSomething |= Channel->ReplicateSubobject(Item, *Bunch, *RepFlags);
 			}
@@ -195,24 +991,55 @@ bool UInventoryComponent::ReplicateSubobjects(class UActorChannel* Channel, clas
 	return bWroteSomething;
 }
 
-UItem* UInventoryComponent::AddItem(class UItem* Item)
+int32 UInventoryComponent::AddItem(class UItem* Item, const int32 Quantity)
 {
 	if (GetOwner() && GetOwner()->HasAuthority())
 	{
-		UItem* NewItem = NewObject<UItem>(GetOwner(), Item->GetClass());
-		NewItem->World = GetWorld();
-		NewItem->SetQuantity(Item->GetQuantity());
-		NewItem->OwningInventoryComponent = this;
-		NewItem->AddedToInventory(this);
+		int32 NewIndex = INDEX_NONE;
 
-		Items_Array.Add(NewItem);
-		NewItem->MarkDirtyForReplication();
-		
-		OnRep_Items();
+		if (bUseCompactStorage && Item->CanUseCompactStorage())
+		{
+			NewIndex = InventoryItems.Entries.Add(FInventoryItemEntry(Item->GetClass(), FMath::Clamp(Quantity, 0, Item->MaxStackSize)));
+		}
+		else
+		{
+			UItem* NewItem = UItemPoolSubsystem::AcquireItem(GetWorld(), Item->GetClass(), GetOwner());
+			NewItem->World = GetWorld();
+			NewItem->SetQuantity(Quantity);
+			NewItem->OwningInventoryComponent = this;
+			NewItem->AddedToInventory(this);
+
+			NewIndex = InventoryItems.Entries.Add(FInventoryItemEntry(NewItem));
+			NewItem->MarkDirtyForReplication();
+		}
+		IndexItemAt(NewIndex);
+
+		const FInventoryItemEntry& NewEntry = InventoryItems.Entries[NewIndex];
+		CurrentWeight += NewEntry.GetStackWeight();
+		CurrentItemCount += NewEntry.GetQuantity();
+		ValidateAggregates();
 
-		return NewItem;
+		BroadcastClassChanged(NewEntry.GetItemClass());
+
+		if (OnItemAdded.IsBound())
+		{
+			OnItemAdded.Broadcast(GetItemAt(NewIndex));
+		}
+
+		if (IsBatching())
+		{
+			//Entries without a replication id get one when the array is next serialized
+			bBatchModifiedItems = true;
+		}
+		else
+		{
+			InventoryItems.MarkItemDirty(InventoryItems.Entries[NewIndex]);
+			OnInventoryUpdated.Broadcast();
+		}
+
+		return NewIndex;
 	}
-	return nullptr;
+	return INDEX_NONE;
 }
 
 FItemAddResult UInventoryComponent::TryAddItem_Internal(class UItem* Item)
@@ -220,84 +1047,181 @@ FItemAddResult UInventoryComponent::TryAddItem_Internal(class UItem* Item)
 	if (GetOwner() && GetOwner()->HasAuthority())
 	{
 		const int32 AddAmount = Item->GetQuantity();
+		const int32 MaxStackSize = Item->bStackable ? Item->MaxStackSize : 1;
 
-		if (Items_Array.Num() + 1 > GetCapacity())
+		if (Item->bStackable)
 		{
-			return FItemAddResult::AddedNone(AddAmount, LOCTEXT("InventoryCapacityFullText", "Couldn't add items to the inventory. Inventory is full."));
+			ensure(AddAmount <= Item->MaxStackSize);
+		}
+		else
+		{
+			ensure(AddAmount == 1);
 		}
 
+		int32 WeightMaxAddAmount = AddAmount;
 		if (!FMath::IsNearlyZero(Item->Weight))
 		{
-			if (GetCurrentWeight() + Item->Weight > GetWeightCapacity())
+			WeightMaxAddAmount = FMath::Clamp(FMath::FloorToInt((GetWeightCapacity() - GetCurrentWeight()) / Item->Weight), 0, AddAmount);
+			if (WeightMaxAddAmount <= 0)
 			{
 				return FItemAddResult::AddedNone(AddAmount, LOCTEXT("InventoryTooMuchWeightText", "Couldn't add items to the inventory. Carrying too much weight."));
 			}
 		}
 
+		TArray<FItemStackAddition> StackAdditions;
+		int32 AmountLeft = WeightMaxAddAmount;
+		bool bHadPartialStacks = false;
+
+		//Top up every partial stack of this class before taking any new slots
 		if (Item->bStackable)
 		{
-			ensure(Item->GetQuantity() <= Item->MaxStackSize);
-			if (UItem* ExistingItem = FindItem(Item))
+			if (const TArray<int32>* Indices = ItemIndicesByClass.Find(Item->GetClass()))
 			{
-				if (ExistingItem->GetQuantity() < ExistingItem->MaxStackSize)
+				for (const int32 Index : *Indices)
 				{
-					const int32 CapacityMaxAddAmount = ExistingItem->MaxStackSize - ExistingItem->GetQuantity();
-					int32 ActualAddAmount = FMath::Min(AddAmount, CapacityMaxAddAmount);
-
-					FText ErrorText = LOCTEXT("InventoryErrorText", "Couldn't add all the items to the inventory");
-
-					if (!FMath::IsNearlyZero(Item->Weight))
+					const FInventoryItemEntry& Entry = InventoryItems.Entries[Index];
+					const int32 StackSpace = Entry.GetItemClass() ? MaxStackSize - Entry.GetQuantity() : 0;
+					if (StackSpace > 0)
 					{
-						const int32 WeightMaxAddAmount = FMath::FloorToInt((WeightCapacity - GetCurrentWeight()) / Item->Weight);
-						ActualAddAmount = FMath::Min(ActualAddAmount, WeightMaxAddAmount);
+						bHadPartialStacks = true;
 
-						if (ActualAddAmount < AddAmount)
+						const int32 StackAddAmount = FMath::Min(StackSpace, AmountLeft);
+						SetEntryQuantity(Index, Entry.GetQuantity() + StackAddAmount);
+						ensure(Entry.GetQuantity() <= MaxStackSize);
+
+						StackAdditions.Add(FItemStackAddition(Entry.GetItemClass(), Entry.GetItem(), StackAddAmount, false));
+						AmountLeft -= StackAddAmount;
+						if (AmountLeft <= 0)
 						{
-							ErrorText = FText::Format(LOCTEXT("InventoryTooMuchWeightText", "Couldn't add entire stack of {Item Name} to Inventory."), Item->ItemDisplayName);
+							break;
 						}
 					}
-					else if (ActualAddAmount < AddAmount)
-					{
-						ErrorText = FText::Format(LOCTEXT("InventoryCapacityFullText", "Couldn't add entire stack of {Item Name} to Inventory."), Item->ItemDisplayName);
-					}
-					if (ActualAddAmount <= 0)
-					{
-						return FItemAddResult::AddedNone(AddAmount, LOCTEXT("InventoryErrorText", "Couldn't add item to inventory"));
-					}
+				}
+			}
+		}
 
-					ExistingItem->SetQuantity(ExistingItem->GetQuantity() + ActualAddAmount);
+		//Spill whatever is left into new stacks while there are free slots
+		while (AmountLeft > 0 && InventoryItems.Entries.Num() < GetCapacity())
+		{
+			const int32 StackAddAmount = FMath::Min(AmountLeft, MaxStackSize);
+			const int32 NewIndex = AddItem(Item, StackAddAmount);
+			if (NewIndex == INDEX_NONE)
+			{
+				break;
+			}
+			const FInventoryItemEntry& NewEntry = InventoryItems.Entries[NewIndex];
+			StackAdditions.Add(FItemStackAddition(NewEntry.GetItemClass(), NewEntry.GetItem(), StackAddAmount, true));
+			AmountLeft -= StackAddAmount;
+		}
 
-					ensure(ExistingItem->GetQuantity() <= ExistingItem->MaxStackSize);
+		const int32 ActualAddAmount = WeightMaxAddAmount - AmountLeft;
+		FItemAddResult AddResult;
 
-					if (ActualAddAmount < AddAmount)
-					{
-						return FItemAddResult::AddedSome(AddAmount, ActualAddAmount, ErrorText);
-					}
-					else
-					{
-						return FItemAddResult::AddedAll(AddAmount);
-					}
-				}
-				else
-				{
-					return FItemAddResult::AddedNone(AddAmount, FText::Format(LOCTEXT("InventoryFullStackText", "Couldn't add {item name} you already have a full stack"),  Item->ItemDisplayName));
-				}
+		if (ActualAddAmount >= AddAmount)
+		{
+			AddResult = FItemAddResult::AddedAll(AddAmount);
+		}
+		else if (ActualAddAmount <= 0)
+		{
+			if (Item->bStackable && !bHadPartialStacks && ItemIndicesByClass.Contains(Item->GetClass()))
+			{
+				AddResult = FItemAddResult::AddedNone(AddAmount, FText::Format(LOCTEXT("InventoryFullStackText", "Couldn't add {item name} you already have a full stack"), Item->ItemDisplayName));
 			}
 			else
 			{
-				AddItem(Item);
-				return FItemAddResult::AddedAll(AddAmount);
+				AddResult = FItemAddResult::AddedNone(AddAmount, LOCTEXT("InventoryCapacityFullText", "Couldn't add items to the inventory. Inventory is full."));
 			}
 		}
+		else if (WeightMaxAddAmount < AddAmount)
+		{
+			AddResult = FItemAddResult::AddedSome(AddAmount, ActualAddAmount, FText::Format(LOCTEXT("InventoryTooMuchWeightText", "Couldn't add entire stack of {Item Name} to Inventory."), Item->ItemDisplayName));
+		}
 		else
 		{
-			ensure(Item->GetQuantity() == 1);
-
-			AddItem(Item);
-			return FItemAddResult::AddedAll(AddAmount);
+			AddResult = FItemAddResult::AddedSome(AddAmount, ActualAddAmount, FText::Format(LOCTEXT("InventoryCapacityFullText", "Couldn't add entire stack of {Item Name} to Inventory."), Item->ItemDisplayName));
 		}
+
+		AddResult.StackAdditions = MoveTemp(StackAdditions);
+		return AddResult;
 	}
 	check(false);
 	return FItemAddResult::AddedNone(-1, LOCTEXT("ErrorMessage", ""));
 }
+
+FInventoryBatchScope::FInventoryBatchScope(UInventoryComponent* InInventory) : Inventory(InInventory)
+{
+	if (Inventory)
+	{
+		Inventory->BeginBatch();
+	}
+}
+
+FInventoryBatchScope::~FInventoryBatchScope()
+{
+	if (Inventory)
+	{
+		Inventory->EndBatch();
+	}
+}
+
+FItemAddResult FInventoryBatchScope::TryAddItem(class UItem* Item)
+{
+	FItemAddResult Result = Inventory && Item ? Inventory->TryAddItem(Item) : FItemAddResult::AddedNone(0, FText::GetEmpty());
+	Results.Add(Result);
+	return Result;
+}
+
+FItemAddResult FInventoryBatchScope::TryAddItemFromClass(TSubclassOf<class UItem> ItemClass, const int32 Quantity)
+{
+	FItemAddResult Result = Inventory && ItemClass ? Inventory->TryAddItemFromClass(ItemClass, Quantity) : FItemAddResult::AddedNone(Quantity, FText::GetEmpty());
+	Results.Add(Result);
+	return Result;
+}
+
+bool FInventoryBatchScope::RemoveItem(class UItem* Item)
+{
+	return Inventory ? Inventory->RemoveItem(Item) : false;
+}
+
+int32 FInventoryBatchScope::ConsumeItem(class UItem* Item, const int32 Quantity)
+{
+	return Inventory ? Inventory->ConsumeItem(Item, Quantity) : 0;
+}
+
+FItemAddResult FInventoryBatchScope::GetAggregateResult() const
+{
+	int32 AmountToGive = 0;
+	int32 AmountActuallyGiven = 0;
+	FText ErrorText;
+	TArray<FItemStackAddition> StackAdditions;
+
+	for (const FItemAddResult& Result : Results)
+	{
+		AmountToGive += Result.AmountToGive;
+		AmountActuallyGiven += Result.AmountActuallyGiven;
+		StackAdditions.Append(Result.StackAdditions);
+
+		if (!Result.ErrorText.IsEmpty())
+		{
+			ErrorText = Result.ErrorText;
+		}
+	}
+
+	FItemAddResult AggregateResult;
+	if (AmountActuallyGiven >= AmountToGive)
+	{
+		AggregateResult = FItemAddResult::AddedAll(AmountToGive);
+	}
+	else if (AmountActuallyGiven <= 0)
+	{
+		AggregateResult = FItemAddResult::AddedNone(AmountToGive, ErrorText);
+	}
+	else
+	{
+		AggregateResult = FItemAddResult::AddedSome(AmountToGive, AmountActuallyGiven, ErrorText);
+	}
+	AggregateResult.StackAdditions = MoveTemp(StackAdditions);
+	return AggregateResult;
+}
+
 #undef LOCTEXT_NAMESPACE
\ No newline at end of file
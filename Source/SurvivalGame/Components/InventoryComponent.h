@@ -5,9 +5,15 @@
 #include "CoreMinimal.h"
 #include "Items/Item.h"
 #include "Components/ActorComponent.h"
+#include "Engine/NetSerialization.h"
 #include "InventoryComponent.generated.h"
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnInventoryUpdated);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnInventoryItemAdded, UItem*, Item);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnInventoryItemChanged, UItem*, Item);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnInventoryItemRemoved, UItem*, Item);
+//Native only, tells listeners that cache something per item class, such as held quantities, which class to refresh
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnInventoryClassChanged, UClass* /*ItemClass*/);
 
 UENUM(BlueprintType)
 enum class EItemAddResult : uint8
@@ -18,6 +24,48 @@ enum class EItemAddResult : uint8
 };
 
 
+//How much of an add went into a single stack
+USTRUCT(BlueprintType)
+struct FItemStackAddition
+{
+	GENERATED_BODY()
+
+public:
+
+	FItemStackAddition() : ItemClass(nullptr), Item(nullptr), AmountAdded(0), bNewStack(false) {};
+	FItemStackAddition(TSubclassOf<UItem> InItemClass, UItem* InItem, int32 InAmountAdded, bool bInNewStack) : ItemClass(InItemClass), Item(InItem), AmountAdded(InAmountAdded), bNewStack(bInNewStack) {};
+
+	UPROPERTY(BlueprintReadOnly, Category = "ItemAddResult")
+	TSubclassOf<UItem> ItemClass;
+	//Null for compact stacks nothing has asked a UItem for yet
+	UPROPERTY(BlueprintReadOnly, Category = "ItemAddResult")
+	UItem* Item;
+	UPROPERTY(BlueprintReadOnly, Category = "ItemAddResult")
+	int32 AmountAdded;
+	UPROPERTY(BlueprintReadOnly, Category = "ItemAddResult")
+	bool bNewStack;
+};
+
+//One slot as the UI shows it, read from the entry so compact stacks don't need a UItem
+USTRUCT(BlueprintType)
+struct FInventoryStack
+{
+	GENERATED_BODY()
+
+public:
+
+	FInventoryStack() : ItemClass(nullptr), Quantity(0), Item(nullptr) {};
+	FInventoryStack(TSubclassOf<UItem> InItemClass, int32 InQuantity, UItem* InItem) : ItemClass(InItemClass), Quantity(InQuantity), Item(InItem) {};
+
+	UPROPERTY(BlueprintReadOnly, Category = "Inventory")
+	TSubclassOf<UItem> ItemClass;
+	UPROPERTY(BlueprintReadOnly, Category = "Inventory")
+	int32 Quantity;
+	//Null for compact stacks nothing has asked a UItem for yet, use GetItemOfStack to get one
+	UPROPERTY(BlueprintReadOnly, Category = "Inventory")
+	UItem* Item;
+};
+
 USTRUCT(BlueprintType)
 struct FItemAddResult
 {
@@ -27,7 +75,7 @@ public:
 
 	FItemAddResult() {};
 	FItemAddResult(int32 InItemQuantity) : AmountToGive(InItemQuantity), AmountActuallyGiven(0) {};
-	FItemAddResult(int32 InItemQuantity, int32 InQuantityAdded) : AmountToGive(InItemQuantity), AmountActuallyGiven(InItemQuantity) {};
+	FItemAddResult(int32 InItemQuantity, int32 InQuantityAdded) : AmountToGive(InItemQuantity), AmountActuallyGiven(InQuantityAdded) {};
 
 	UPROPERTY(BlueprintReadOnly, Category = "ItemAddResult")
 	int32 AmountToGive;
@@ -37,6 +85,9 @@ public:
 	EItemAddResult Result;
 	UPROPERTY(BlueprintReadOnly, Category = "ItemAddResult")
 	FText ErrorText;
+	//Exact split of AmountActuallyGiven, existing stacks first followed by any new stacks
+	UPROPERTY(BlueprintReadOnly, Category = "ItemAddResult")
+	TArray<FItemStackAddition> StackAdditions;
 	
 	static FItemAddResult AddedNone(const int32 InItemQuantity, const FText& ErrorText)
 	{
@@ -61,7 +112,140 @@ public:
 		return AddedAllResult;
 	}
 };
- 
+
+//A single inventory slot, replicated on its own whenever it is marked dirty.
+//Simple stackables can be stored compactly as a class and a quantity, everything else keeps a replicated UItem.
+USTRUCT()
+struct FInventoryItemEntry : public FFastArraySerializerItem
+{
+	GENERATED_BODY()
+
+public:
+
+	FInventoryItemEntry() : Item(nullptr), ItemClass(nullptr), Quantity(0), LocalItem(nullptr) {};
+	FInventoryItemEntry(UItem* InItem) : Item(InItem), ItemClass(nullptr), Quantity(0), LocalItem(nullptr) {};
+	FInventoryItemEntry(TSubclassOf<UItem> InItemClass, int32 InQuantity) : Item(nullptr), ItemClass(InItemClass), Quantity(InQuantity), LocalItem(nullptr) {};
+
+	//The item of a regular entry, replicated as a subobject of the inventory owner
+	UPROPERTY()
+	UItem* Item;
+
+	//Only set for compact entries, static item data is read from the class default object
+	UPROPERTY()
+	TSubclassOf<UItem> ItemClass;
+
+	UPROPERTY()
+	int32 Quantity;
+
+	//Local stand in for a compact entry, only created once something asks for a UItem
+	UPROPERTY(NotReplicated)
+	UItem* LocalItem;
+
+	FORCEINLINE bool IsCompact() const { return ItemClass != nullptr; };
+	FORCEINLINE UItem* GetItem() const { return IsCompact() ? LocalItem : Item; };
+	FORCEINLINE UClass* GetItemClass() const { return IsCompact() ? ItemClass.Get() : (Item ? Item->GetClass() : nullptr); };
+	FORCEINLINE int32 GetQuantity() const { return IsCompact() ? Quantity : (Item ? Item->GetQuantity() : 0); };
+	FORCEINLINE float GetStackWeight() const { return IsCompact() ? Quantity * ItemClass->GetDefaultObject<UItem>()->Weight : (Item ? Item->GetStackWeight() : 0.f); };
+
+	void PreReplicatedRemove(const struct FInventoryItemList& InArraySerializer);
+	void PostReplicatedAdd(const struct FInventoryItemList& InArraySerializer);
+	void PostReplicatedChange(const struct FInventoryItemList& InArraySerializer);
+};
+
+USTRUCT()
+struct FInventoryItemList : public FFastArraySerializer
+{
+	GENERATED_BODY()
+
+public:
+
+	FInventoryItemList() : OwnerComponent(nullptr) {};
+
+	UPROPERTY()
+	TArray<FInventoryItemEntry> Entries;
+
+	//Not a UPROPERTY so it's never copied over from an archetype
+	class UInventoryComponent* OwnerComponent;
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+	{
+		return FFastArraySerializer::FastArrayDeltaSerialize<FInventoryItemEntry, FInventoryItemList>(Entries, DeltaParms, *this);
+	}
+};
+
+//Items the owning client shows before the server has confirmed the add that gives them
+USTRUCT()
+struct FPredictedInventoryAdd
+{
+	GENERATED_BODY()
+
+public:
+
+	FPredictedInventoryAdd() : PredictionKey(0), ItemClass(nullptr), Quantity(0), Item(nullptr) {};
+
+	UPROPERTY()
+	int32 PredictionKey;
+
+	UPROPERTY()
+	TSubclassOf<UItem> ItemClass;
+
+	//The whole predicted amount, which may span several stacks. The stand in can't hold more than one stack so this is what counts
+	UPROPERTY()
+	int32 Quantity;
+
+	//Local stand in listed by GetItems until the server answers
+	UPROPERTY()
+	UItem* Item;
+
+	//Actor the items were predicted to be taken from, hidden locally until the server answers
+	TWeakObjectPtr<AActor> SourceActor;
+};
+
+//How much the server gave for one prediction key
+USTRUCT()
+struct FInventoryPredictionResult
+{
+	GENERATED_BODY()
+
+public:
+
+	FInventoryPredictionResult() : PredictionKey(0), AmountGiven(0) {};
+	FInventoryPredictionResult(int32 InPredictionKey, int32 InAmountGiven) : PredictionKey(InPredictionKey), AmountGiven(InAmountGiven) {};
+
+	UPROPERTY()
+	int32 PredictionKey;
+
+	UPROPERTY()
+	int32 AmountGiven;
+};
+
+//The newest prediction the server has resolved for the owning client
+USTRUCT()
+struct FInventoryPredictionAck
+{
+	GENERATED_BODY()
+
+public:
+
+	FInventoryPredictionAck() : PredictionKey(0) {};
+
+	UPROPERTY()
+	int32 PredictionKey;
+
+	//The last few keys resolved, oldest first. Several acks can reach the client in one update and each keeps its own amount
+	UPROPERTY()
+	TArray<FInventoryPredictionResult> RecentResults;
+};
+
+template<>
+struct TStructOpsTypeTraits<FInventoryItemList> : public TStructOpsTypeTraitsBase2<FInventoryItemList>
+{
+	enum
+	{
+		WithNetDeltaSerializer = true,
+	};
+};
+
 
 UCLASS( ClassGroup=(Custom), meta=(BlueprintSpawnableComponent) )
 class SURVIVALGAME_API UInventoryComponent : public UActorComponent
@@ -69,6 +253,10 @@ class SURVIVALGAME_API UInventoryComponent : public UActorComponent
 	GENERATED_BODY()
 
 	friend class UItem;
+	friend struct FInventoryItemEntry;
+	friend struct FInventoryBatchScope;
+	friend class FInventorySnapshotWriter;
+	friend class FInventorySnapshotReader;
 
 public:	
 	// Sets default values for this component's properties
@@ -86,18 +274,31 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Inventory")
 	bool RemoveItem(UItem* Item);
 
+	//Consumes up to Quantity items of ItemClass across all its stacks, returns the amount consumed
+	int32 ConsumeItemsByClass(TSubclassOf<UItem> ItemClass, const int32 Quantity);
+
 	//Utils
 	UFUNCTION(BlueprintPure, Category = "Inventory")
 	bool HasItem(TSubclassOf<UItem> ItemClass, const int32 Quantity = 1) const;
+	//The Find functions and GetItems only return UItems that already exist, compact stacks nothing has asked a UItem for are skipped
 	UFUNCTION(BlueprintPure, Category = "Inventory")
 	UItem* FindItem(UItem* Item) const;
 	UFUNCTION(BlueprintPure, Category = "Inventory")
 	UItem* FindItemByClass(TSubclassOf<UItem> ItemClass) const;
 	UFUNCTION(BlueprintPure, Category = "Inventory")
 	TArray<UItem*> FindItemsByClass(TSubclassOf<UItem> ItemClass) const;
+	//The UItem of the first stack of ItemClass, creating the stand in of a compact stack if it doesn't have one yet
+	UFUNCTION(BlueprintCallable, Category = "Inventory")
+	UItem* GetOrCreateItemObject(TSubclassOf<UItem> ItemClass);
+	//Total quantity held of exactly ItemClass, summed over all of its stacks
+	UFUNCTION(BlueprintPure, Category = "Inventory")
+	int32 GetItemQuantityByClass(TSubclassOf<UItem> ItemClass) const;
 	
 	UFUNCTION(BlueprintPure, Category = "Inventory")
 	float GetCurrentWeight() const;
+	//Total amount of items held, counting every unit of every stack
+	UFUNCTION(BlueprintPure, Category = "Inventory")
+	int32 GetCurrentItemCount() const;
 	UFUNCTION(BlueprintCallable, Category = "Inventory")
 	void SetWeightCapacity(const float NewWeightCapacity);
 	UFUNCTION(BlueprintCallable, Category = "Inventory")
@@ -110,33 +311,142 @@ public:
 	FORCEINLINE int32 GetCapacity() const { return Capacity; };
 		
 	UFUNCTION(BlueprintPure, Category = "Inventory")
-	FORCEINLINE TArray<UItem*> GetItems() const { return Items_Array; };
+	TArray<UItem*> GetItems() const;
+
+	//Every slot followed by the predicted ones, without creating any UItem. Prefer this for listing the inventory
+	UFUNCTION(BlueprintPure, Category = "Inventory")
+	TArray<FInventoryStack> GetStacks() const;
+
+	//The UItem of a stack returned by GetStacks, created for compact stacks. Only needed to use, drop or inspect the item
+	UFUNCTION(BlueprintCallable, Category = "Inventory")
+	UItem* GetItemOfStack(const int32 StackIndex);
 
 	UFUNCTION(Client, Reliable)
 	void RefreshClientInventory();
 
+	/**Client side. Shows the result of an add straight away under a prediction key the server answers through AcknowledgePrediction.
+	Returns the amount predicted to fit, nothing is predicted if it's 0.*/
+	int32 PredictAddItem(const int32 PredictionKey, TSubclassOf<UItem> ItemClass, const int32 Quantity, AActor* SourceActor = nullptr);
+
+	/**Server side. Resolves every prediction of the owning client up to PredictionKey, keys without an ack of their own count
+	as nothing given. The ack replicates together with the authoritative items, so the predicted stand ins are swapped for the
+	real items in the same update.*/
+	void AcknowledgePrediction(const int32 PredictionKey, const int32 AmountGiven);
+
+	//How many of ItemClass would be added out of Quantity, following the weight and slot rules of TryAddItem
+	int32 GetAmountThatFits(TSubclassOf<UItem> ItemClass, const int32 Quantity) const;
+
+	//Only takes effect for items added afterwards, set it up before the inventory is filled
+	void SetUseCompactStorage(const bool bNewUseCompactStorage);
+	FORCEINLINE bool UsesCompactStorage() const { return bUseCompactStorage; };
+
 	UPROPERTY(BlueprintAssignable)
 	FOnInventoryUpdated OnInventoryUpdated;
 
+	UPROPERTY(BlueprintAssignable)
+	FOnInventoryItemAdded OnItemAdded;
+
+	UPROPERTY(BlueprintAssignable)
+	FOnInventoryItemChanged OnItemChanged;
+
+	UPROPERTY(BlueprintAssignable)
+	FOnInventoryItemRemoved OnItemRemoved;
+
+	//Broadcast whenever a stack of a class is added, removed or changes quantity, on the server and on clients
+	FOnInventoryClassChanged OnClassChanged;
+
 
 protected:
 	// Called when the game starts
 	virtual void BeginPlay() override;
 
 private:
+	//Client side handlers for the per entry fast array callbacks
+	void OnEntryReplicatedAdd(FInventoryItemEntry& Entry);
+	void OnEntryReplicatedChange(FInventoryItemEntry& Entry);
+	void OnEntryReplicatedRemove(FInventoryItemEntry& Entry);
+
+	//Returns the item of an entry, creating the local stand in of a compact entry if needed
+	UItem* GetItemAt(const int32 Index);
+	UItem* MaterializeCompactItem(FInventoryItemEntry& Entry);
+
+	//Sets the quantity of a stack without needing a UItem for compact entries
+	void SetEntryQuantity(const int32 Index, const int32 NewQuantity);
+	void RemoveItemAt(const int32 Index);
+	void RemoveAllItems();
+
+	//Clients get entries in any order and removals swap slots, so the totals and class index are rebuilt lazily on the next query
+	void MarkClientCachesDirty();
+	void RefreshClientCaches() const;
+
+	void BroadcastInventoryUpdated();
+	void BroadcastClassChanged(UClass* ItemClass);
+
 	UFUNCTION()
-	void OnRep_Items();
+	void OnRep_PredictionAck();
+	//Drops the predictions up to the acked key, the source of a prediction is shown again unless the server took all of it
+	void ResolvePredictions(const FInventoryPredictionAck& Ack);
+
+	//Client side only, unconfirmed adds in the order they were predicted
+	UPROPERTY()
+	TArray<FPredictedInventoryAdd> PredictedAdds;
+
+	float PredictedWeight;
+	int32 PredictedItemCount;
+	int32 PredictedSlotCount;
 
 	UPROPERTY()
 	int32 ReplicatedItemsKey;
 
-	UItem* AddItem(UItem* Item);
+	mutable bool bClientCachesDirty;
+	bool bInventoryUpdatePending;
+
+	void BeginBatch();
+	void EndBatch();
+	FORCEINLINE bool IsBatching() const { return BatchDepth > 0; };
+
+	//While batching, replication dirtying and UI broadcasts are deferred to the end of the outermost batch
+	int32 BatchDepth;
+	bool bBatchModifiedItems;
+	bool bBatchNeedsClientRefresh;
+
+	//Bumps the key that makes the item subobjects replicate, a batch bumps it once when it ends
+	void MarkItemsDirty();
+
+	//Adds a new stack holding Quantity copies of Item, returns its index
+	int32 AddItem(UItem* Item, const int32 Quantity);
 
 	FItemAddResult TryAddItem_Internal(UItem* Item);
 
+	//Called by items when their quantity changes so the running totals stay in sync
+	void OnItemQuantityChanged(UItem* Item, const int32 OldQuantity);
+
+	void RecalculateAggregates();
+	//Compares the running totals against a full recompute, only does work when SurvivalGame.ValidateInventoryAggregates is set (default in Debug builds)
+	void ValidateAggregates() const;
+
+	//Running totals of InventoryItems, kept up to date on every mutation so weight checks don't walk the inventory
+	float CurrentWeight;
+	int32 CurrentItemCount;
+
+	void IndexItemAt(const int32 Index);
+	void UnindexItemAt(const int32 Index);
+	void RebuildItemIndex();
+	int32 FindItemIndex(const UItem* Item) const;
+	//Every held class that is Class or a child of it, cached until a class enters or leaves the index
+	const TArray<UClass*>& GetHeldSubclassesOf(UClass* Class) const;
+
+	//Indices into InventoryItems grouped by exact item class, in array order
+	TMap<UClass*, TArray<int32>> ItemIndicesByClass;
+
+	mutable TMap<UClass*, TArray<UClass*>> SubclassQueryCache;
+
 protected:
-	UPROPERTY(ReplicatedUsing = OnRep_Items, VisibleAnywhere, Category = "Inventory")
-	TArray<UItem*> Items_Array;
+	UPROPERTY(Replicated, VisibleAnywhere, Category = "Inventory")
+	FInventoryItemList InventoryItems;
+
+	UPROPERTY(ReplicatedUsing = OnRep_PredictionAck)
+	FInventoryPredictionAck PredictionAck;
 	
 	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
 	virtual bool ReplicateSubobjects(UActorChannel* Channel, FOutBunch* Bunch, FReplicationFlags* RepFlags) override;
@@ -147,4 +457,37 @@ protected:
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Inventory")
 	float WeightCapacity;
 
+	//Store simple stackables as a class and quantity instead of a replicated UItem each
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Inventory")
+	bool bUseCompactStorage;
+
+};
+
+/**
+ * Groups a run of inventory changes, such as filling a loot container, so the inventory
+ * is only marked dirty for replication and broadcasts OnInventoryUpdated once, when the scope ends.
+ * Scopes can be nested, only the outermost one flushes.
+ */
+struct SURVIVALGAME_API FInventoryBatchScope
+{
+	explicit FInventoryBatchScope(UInventoryComponent* InInventory);
+	~FInventoryBatchScope();
+
+	UE_NONCOPYABLE(FInventoryBatchScope);
+
+	FItemAddResult TryAddItem(UItem* Item);
+	FItemAddResult TryAddItemFromClass(TSubclassOf<UItem> ItemClass, const int32 Quantity);
+	bool RemoveItem(UItem* Item);
+	int32 ConsumeItem(UItem* Item, const int32 Quantity);
+
+	//Results of every add made through this scope, in call order
+	FORCEINLINE const TArray<FItemAddResult>& GetResults() const { return Results; };
+
+	//All the adds made through this scope folded into one result
+	FItemAddResult GetAggregateResult() const;
+
+private:
+	UInventoryComponent* Inventory;
+
+	TArray<FItemAddResult> Results;
 };
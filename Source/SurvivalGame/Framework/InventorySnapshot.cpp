@@ -0,0 +1,315 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "InventorySnapshot.h"
+#include "Components/InventoryComponent.h"
+#include "Items/EquippableItem.h"
+#include "Player/SurvivalCharacter.h"
+#include "Weapons/Weapon.h"
+#include "World/Pickup.h"
+#include "UObject/SoftObjectPath.h"
+
+static const uint32 InventorySnapshotMagic = 0x53474953; //SGIS
+
+namespace InventorySnapshotFlags
+{
+	static const uint8 Equipped = 1 << 0;
+}
+
+static void WritePacked(FArchive& Ar, const uint32 Value)
+{
+	uint32 PackedValue = Value;
+	Ar.SerializeIntPacked(PackedValue);
+}
+
+static uint32 ReadPacked(FArchive& Ar)
+{
+	uint32 Value = 0;
+	Ar.SerializeIntPacked(Value);
+	return Value;
+}
+
+FInventorySnapshotWriter::FInventorySnapshotWriter() : RecordWriter(RecordData), NumRecords(0)
+{
+}
+
+uint32 FInventorySnapshotWriter::InternClass(UClass* Class)
+{
+	if (const uint32* ExistingIndex = ClassIndices.Find(Class))
+	{
+		return *ExistingIndex;
+	}
+
+	const uint32 NewIndex = ClassPaths.Add(Class ? Class->GetPathName() : FString());
+	ClassIndices.Add(Class, NewIndex);
+	return NewIndex;
+}
+
+void FInventorySnapshotWriter::WriteInventory(const UInventoryComponent* Inventory)
+{
+	++NumRecords;
+
+	if (!Inventory)
+	{
+		WritePacked(RecordWriter, 0);
+		return;
+	}
+
+	const TArray<FInventoryItemEntry>& Entries = Inventory->InventoryItems.Entries;
+
+	uint32 NumStacks = 0;
+	for (const FInventoryItemEntry& Entry : Entries)
+	{
+		NumStacks += Entry.GetItemClass() ? 1 : 0;
+	}
+	WritePacked(RecordWriter, NumStacks);
+
+	for (const FInventoryItemEntry& Entry : Entries)
+	{
+		if (UClass* ItemClass = Entry.GetItemClass())
+		{
+			const UEquippableItem* Equippable = Cast<UEquippableItem>(Entry.GetItem());
+			uint8 Flags = Equippable && Equippable->IsEquipped() ? InventorySnapshotFlags::Equipped : 0;
+
+			WritePacked(RecordWriter, InternClass(ItemClass));
+			WritePacked(RecordWriter, FMath::Max(Entry.GetQuantity(), 0));
+			RecordWriter << Flags;
+		}
+	}
+}
+
+void FInventorySnapshotWriter::WriteCharacter(const ASurvivalCharacter* Character)
+{
+	WriteInventory(Character ? Character->PlayerInventoryComponent : nullptr);
+
+	//Stored off by one so zero means no weapon
+	const AWeapon* Weapon = Character ? Character->GetEquippedWeapon() : nullptr;
+	WritePacked(RecordWriter, Weapon ? FMath::Max(Weapon->CurrentAmmoInClip, 0) + 1 : 0);
+}
+
+void FInventorySnapshotWriter::WritePickup(const APickup* Pickup)
+{
+	++NumRecords;
+
+	const UItem* Item = Pickup ? Pickup->GetItem() : nullptr;
+	if (!Item)
+	{
+		WritePacked(RecordWriter, 0);
+		return;
+	}
+
+	//Stored off by one so zero means an empty pickup
+	WritePacked(RecordWriter, InternClass(Item->GetClass()) + 1);
+	WritePacked(RecordWriter, FMath::Max(Item->GetQuantity(), 0));
+
+	FVector Location = Pickup->GetActorLocation();
+	float Yaw = Pickup->GetActorRotation().Yaw;
+	RecordWriter << Location;
+	RecordWriter << Yaw;
+}
+
+void FInventorySnapshotWriter::Finalize(TArray<uint8>& OutData) const
+{
+	OutData.Reset();
+
+	FMemoryWriter Writer(OutData);
+
+	uint32 Magic = InventorySnapshotMagic;
+	uint16 Version = (uint16)EInventorySnapshotVersion::Latest;
+	Writer << Magic;
+	Writer << Version;
+
+	WritePacked(Writer, ClassPaths.Num());
+	for (const FString& ClassPath : ClassPaths)
+	{
+		Writer << const_cast<FString&>(ClassPath);
+	}
+
+	WritePacked(Writer, NumRecords);
+	Writer.Serialize(const_cast<uint8*>(RecordData.GetData()), RecordData.Num());
+}
+
+FInventorySnapshotReader::FInventorySnapshotReader(const TArray<uint8>& InData) : Reader(InData), NumRecords(0), bValid(false)
+{
+	uint32 Magic = 0;
+	uint16 Version = 0;
+	Reader << Magic;
+	Reader << Version;
+
+	if (Reader.IsError() || Magic != InventorySnapshotMagic || Version != (uint16)EInventorySnapshotVersion::Latest)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Inventory snapshot has an unknown header or version %d"), Version);
+		return;
+	}
+
+	const uint32 NumClasses = ReadPacked(Reader);
+	for (uint32 i = 0; i < NumClasses && !Reader.IsError(); ++i)
+	{
+		FString ClassPath;
+		Reader << ClassPath;
+
+		//Missing classes stay null so their stacks are skipped instead of failing the whole snapshot
+		UClass* Class = FSoftClassPath(ClassPath).TryLoadClass<UItem>();
+		if (!Class)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Inventory snapshot references missing item class %s"), *ClassPath);
+		}
+		Classes.Add(Class);
+	}
+
+	NumRecords = ReadPacked(Reader);
+	bValid = !Reader.IsError();
+}
+
+bool FInventorySnapshotReader::ReadInventory(UInventoryComponent* Inventory)
+{
+	TArray<FStackRecord> Stacks;
+	if (!ParseInventory(Stacks))
+	{
+		return false;
+	}
+
+	if (Inventory && Inventory->GetOwner() && Inventory->GetOwner()->HasAuthority())
+	{
+		RestoreInventory(Inventory, Stacks, nullptr);
+	}
+	return true;
+}
+
+bool FInventorySnapshotReader::ParseInventory(TArray<FStackRecord>& OutStacks)
+{
+	if (!bValid)
+	{
+		return false;
+	}
+
+	const uint32 NumStacks = ReadPacked(Reader);
+	for (uint32 i = 0; i < NumStacks && !Reader.IsError(); ++i)
+	{
+		const uint32 ClassIndex = ReadPacked(Reader);
+		const uint32 Quantity = ReadPacked(Reader);
+		uint8 Flags = 0;
+		Reader << Flags;
+
+		if (Quantity > (uint32)MAX_int32)
+		{
+			Reader.SetError();
+			break;
+		}
+
+		FStackRecord& Stack = OutStacks.AddDefaulted_GetRef();
+		Stack.ItemClass = Classes.IsValidIndex(ClassIndex) ? Classes[ClassIndex] : nullptr;
+		Stack.Quantity = (int32)Quantity;
+		Stack.Flags = Flags;
+	}
+
+	return !Reader.IsError();
+}
+
+void FInventorySnapshotReader::RestoreInventory(UInventoryComponent* Inventory, const TArray<FStackRecord>& Stacks, TArray<UEquippableItem*>* OutEquippedItems)
+{
+	Inventory->RemoveAllItems();
+
+	FInventoryBatchScope RestoreBatch(Inventory);
+
+	for (const FStackRecord& Stack : Stacks)
+	{
+		if (!Stack.ItemClass || Stack.Quantity == 0 || Inventory->InventoryItems.Entries.Num() >= Inventory->GetCapacity())
+		{
+			continue;
+		}
+
+		const int32 NewIndex = Inventory->AddItem(Stack.ItemClass->GetDefaultObject<UItem>(), Stack.Quantity);
+		if (NewIndex == INDEX_NONE)
+		{
+			continue;
+		}
+
+		//Adding an equippable may auto equip it, only keep the ones that were equipped when saved
+		if (UEquippableItem* Equippable = Cast<UEquippableItem>(Inventory->InventoryItems.Entries[NewIndex].GetItem()))
+		{
+			if (Stack.Flags & InventorySnapshotFlags::Equipped)
+			{
+				if (OutEquippedItems)
+				{
+					OutEquippedItems->Add(Equippable);
+				}
+			}
+			else if (Equippable->IsEquipped())
+			{
+				Equippable->SetEquipped(false);
+			}
+		}
+	}
+}
+
+bool FInventorySnapshotReader::ReadCharacter(ASurvivalCharacter* Character)
+{
+	TArray<FStackRecord> Stacks;
+	const bool bParsedInventory = ParseInventory(Stacks);
+	const uint32 StoredClipAmmo = bParsedInventory ? ReadPacked(Reader) : 0;
+
+	//Nothing is unequipped or removed until the whole record has been read
+	if (!bParsedInventory || Reader.IsError() || !Character || !Character->HasAuthority() || !Character->PlayerInventoryComponent)
+	{
+		return false;
+	}
+
+	TArray<UEquippableItem*> CurrentlyEquipped;
+	Character->GetEquippedItems().GenerateValueArray(CurrentlyEquipped);
+
+	for (UEquippableItem* EquippedItem : CurrentlyEquipped)
+	{
+		EquippedItem->SetEquipped(false);
+	}
+
+	TArray<UEquippableItem*> EquippedItems;
+	RestoreInventory(Character->PlayerInventoryComponent, Stacks, &EquippedItems);
+
+	for (UEquippableItem* Equippable : EquippedItems)
+	{
+		if (!Equippable->IsEquipped())
+		{
+			Equippable->SetEquipped(true);
+		}
+	}
+
+	if (AWeapon* Weapon = Character->GetEquippedWeapon())
+	{
+		if (StoredClipAmmo > 0)
+		{
+			Weapon->CurrentAmmoInClip = FMath::Clamp((int32)StoredClipAmmo - 1, 0, Weapon->GetAmmoPerClip());
+		}
+	}
+	return true;
+}
+
+bool FInventorySnapshotReader::ReadPickup(APickup* Pickup)
+{
+	if (!bValid)
+	{
+		return false;
+	}
+
+	const uint32 StoredClassIndex = ReadPacked(Reader);
+	if (StoredClassIndex == 0)
+	{
+		return !Reader.IsError();
+	}
+
+	const uint32 Quantity = ReadPacked(Reader);
+	FVector Location;
+	float Yaw = 0.f;
+	Reader << Location;
+	Reader << Yaw;
+
+	const uint32 ClassIndex = StoredClassIndex - 1;
+	UClass* ItemClass = Classes.IsValidIndex(ClassIndex) ? Classes[ClassIndex] : nullptr;
+	if (Reader.IsError() || !Pickup || !Pickup->HasAuthority() || !ItemClass)
+	{
+		return false;
+	}
+
+	Pickup->InitializePickup(ItemClass, (int32)Quantity);
+	Pickup->SetActorLocationAndRotation(Location, FRotator(0.f, Yaw, 0.f));
+	return true;
+}
@@ -0,0 +1,105 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Serialization/MemoryWriter.h"
+#include "Serialization/MemoryReader.h"
+
+class UInventoryComponent;
+class ASurvivalCharacter;
+class APickup;
+
+//Bump when the snapshot layout changes, snapshots from other versions are rejected
+enum class EInventorySnapshotVersion : uint16
+{
+	Initial = 1,
+
+	VersionPlusOne,
+	Latest = VersionPlusOne - 1
+};
+
+/**
+ * Writes inventories, equipped slots and clip ammo into a compact, versioned binary snapshot.
+ * Item classes are interned into a table that is written once in front of the records, and
+ * counts, class indices and quantities are all packed. Records must be read back in the order
+ * they were written.
+ */
+class SURVIVALGAME_API FInventorySnapshotWriter
+{
+public:
+
+	FInventorySnapshotWriter();
+
+	UE_NONCOPYABLE(FInventorySnapshotWriter);
+
+	//Every stack of the inventory, including which ones are equipped
+	void WriteInventory(const UInventoryComponent* Inventory);
+	//The player inventory plus the clip ammo of the equipped weapon
+	void WriteCharacter(const ASurvivalCharacter* Character);
+	//Item class, quantity and location of a pickup lying in the world
+	void WritePickup(const APickup* Pickup);
+
+	/**Builds the final snapshot. Only reads data captured by the Write calls, so this can run off the game thread*/
+	void Finalize(TArray<uint8>& OutData) const;
+
+	FORCEINLINE int32 GetNumRecords() const { return NumRecords; };
+
+private:
+
+	uint32 InternClass(UClass* Class);
+
+	//Paths are resolved while interning so finalizing never has to touch UObjects
+	TArray<FString> ClassPaths;
+	TMap<UClass*, uint32> ClassIndices;
+
+	TArray<uint8> RecordData;
+	FMemoryWriter RecordWriter;
+
+	int32 NumRecords;
+};
+
+/**
+ * Restores records written by FInventorySnapshotWriter, in the same order. Server only.
+ */
+class SURVIVALGAME_API FInventorySnapshotReader
+{
+public:
+
+	explicit FInventorySnapshotReader(const TArray<uint8>& InData);
+
+	UE_NONCOPYABLE(FInventorySnapshotReader);
+
+	//False if the header, version or class table couldn't be read
+	FORCEINLINE bool IsValid() const { return bValid; };
+	FORCEINLINE int32 GetNumRecords() const { return NumRecords; };
+
+	/**Replaces the contents of the inventory with the next record. The record is read in full first, so a corrupt
+	record leaves the inventory untouched*/
+	bool ReadInventory(UInventoryComponent* Inventory);
+	//Replaces the inventory and equipped items of the character with the next record, same guarantee as ReadInventory
+	bool ReadCharacter(ASurvivalCharacter* Character);
+	//Initializes the pickup with the saved item and moves it to where it was saved
+	bool ReadPickup(APickup* Pickup);
+
+private:
+
+	struct FStackRecord
+	{
+		//Null if the class couldn't be loaded, the stack is skipped on restore
+		UClass* ItemClass;
+		int32 Quantity;
+		uint8 Flags;
+	};
+
+	//Reads a whole inventory record without touching the inventory, false if the record is truncated or corrupt
+	bool ParseInventory(TArray<FStackRecord>& OutStacks);
+	void RestoreInventory(UInventoryComponent* Inventory, const TArray<FStackRecord>& Stacks, TArray<class UEquippableItem*>* OutEquippedItems);
+
+	FMemoryReader Reader;
+
+	TArray<UClass*> Classes;
+
+	int32 NumRecords;
+	bool bValid;
+};
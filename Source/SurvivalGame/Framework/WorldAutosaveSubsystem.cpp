@@ -0,0 +1,266 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "WorldAutosaveSubsystem.h"
+#include "Framework/InventorySnapshot.h"
+#include "Player/SurvivalCharacter.h"
+#include "World/LootableActor.h"
+#include "World/Pickup.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/PlayerState.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/Compression.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryWriter.h"
+
+static TAutoConsoleVariable<float> CVarAutosaveInterval(
+	TEXT("SurvivalGame.AutosaveInterval"),
+	0.f,
+	TEXT("Seconds between world autosaves on the server. 0 (the default) disables autosaving, PIE sessions never autosave"));
+
+static TAutoConsoleVariable<float> CVarAutosaveCaptureBudgetMs(
+	TEXT("SurvivalGame.AutosaveCaptureBudgetMs"),
+	1.f,
+	TEXT("Game thread milliseconds an autosave may spend capturing records each frame, at least one record is captured per frame"));
+
+static const uint32 WorldAutosaveMagic = 0x53474153; //SGAS
+static const uint16 WorldAutosaveVersion = 1;
+
+UWorldAutosaveSubsystem::UWorldAutosaveSubsystem()
+{
+	bInitialized = false;
+	TimeSinceLastSave = 0.f;
+	NextSaveSlot = 0;
+}
+
+void UWorldAutosaveSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	bInitialized = true;
+}
+
+void UWorldAutosaveSubsystem::Deinitialize()
+{
+	bInitialized = false;
+	Capture.Reset();
+
+	//Never leave a half written file behind
+	if (SaveTask.IsValid())
+	{
+		FTaskGraphInterface::Get().WaitUntilTaskCompletes(SaveTask);
+		SaveTask = nullptr;
+	}
+
+	Super::Deinitialize();
+}
+
+ETickableTickType UWorldAutosaveSubsystem::GetTickableTickType() const
+{
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+bool UWorldAutosaveSubsystem::IsTickable() const
+{
+	const UWorld* World = GetWorld();
+	return bInitialized && World && World->IsGameWorld() && World->WorldType != EWorldType::PIE && World->GetNetMode() != NM_Client;
+}
+
+TStatId UWorldAutosaveSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UWorldAutosaveSubsystem, STATGROUP_Tickables);
+}
+
+void UWorldAutosaveSubsystem::Tick(float DeltaTime)
+{
+	if (Capture.IsValid())
+	{
+		if (ContinueCapture())
+		{
+			WriteCapture();
+		}
+		return;
+	}
+
+	const float AutosaveInterval = CVarAutosaveInterval.GetValueOnGameThread();
+	if (AutosaveInterval <= 0.f)
+	{
+		return;
+	}
+
+	TimeSinceLastSave += DeltaTime;
+	if (TimeSinceLastSave >= AutosaveInterval && !IsSaveInProgress())
+	{
+		RequestAutosave();
+	}
+}
+
+bool UWorldAutosaveSubsystem::RequestAutosave()
+{
+	UWorld* World = GetWorld();
+	if (!World || IsSaveInProgress())
+	{
+		return false;
+	}
+
+	TimeSinceLastSave = 0.f;
+
+	const double GatherStartTime = FPlatformTime::Seconds();
+
+	Capture = MakeUnique<FWorldAutosaveCapture>();
+	Capture->Snapshot = MakeShared<FInventorySnapshotWriter, ESPMode::ThreadSafe>();
+
+	//Records are written players first, then containers, then pickups
+	for (TActorIterator<ASurvivalCharacter> It(World); It; ++It)
+	{
+		Capture->Characters.Add(*It);
+	}
+	for (TActorIterator<ALootableActor> It(World); It; ++It)
+	{
+		Capture->Containers.Add(*It);
+	}
+	for (TActorIterator<APickup> It(World); It; ++It)
+	{
+		Capture->Pickups.Add(*It);
+	}
+
+	Capture->CaptureSeconds = FPlatformTime::Seconds() - GatherStartTime;
+	return true;
+}
+
+bool UWorldAutosaveSubsystem::ContinueCapture()
+{
+	FWorldAutosaveCapture& CurrentCapture = *Capture;
+	FInventorySnapshotWriter& Snapshot = *CurrentCapture.Snapshot;
+
+	const double StartTime = FPlatformTime::Seconds();
+	const double EndTime = StartTime + FMath::Max(CVarAutosaveCaptureBudgetMs.GetValueOnGameThread(), 0.f) / 1000.0;
+
+	//Actors destroyed since the capture started are left out, each record is keyed by a stable name
+	bool bBudgetLeft = true;
+	while (bBudgetLeft && CurrentCapture.NextCharacter < CurrentCapture.Characters.Num())
+	{
+		ASurvivalCharacter* Character = CurrentCapture.Characters[CurrentCapture.NextCharacter++].Get();
+		APlayerState* PlayerState = Character ? Character->GetPlayerState() : nullptr;
+		if (PlayerState)
+		{
+			CurrentCapture.PlayerKeys.Add(PlayerState->GetUniqueId().IsValid() ? PlayerState->GetUniqueId().ToString() : PlayerState->GetPlayerName());
+			Snapshot.WriteCharacter(Character);
+			bBudgetLeft = FPlatformTime::Seconds() < EndTime;
+		}
+	}
+	while (bBudgetLeft && CurrentCapture.NextContainer < CurrentCapture.Containers.Num())
+	{
+		if (ALootableActor* Container = CurrentCapture.Containers[CurrentCapture.NextContainer++].Get())
+		{
+			CurrentCapture.ContainerKeys.Add(Container->GetPathName());
+			Snapshot.WriteInventory(Container->LootInventoryComponent);
+			bBudgetLeft = FPlatformTime::Seconds() < EndTime;
+		}
+	}
+	while (bBudgetLeft && CurrentCapture.NextPickup < CurrentCapture.Pickups.Num())
+	{
+		APickup* Pickup = CurrentCapture.Pickups[CurrentCapture.NextPickup++].Get();
+		if (Pickup && !Pickup->IsPendingKillPending())
+		{
+			CurrentCapture.PickupKeys.Add(Pickup->GetPathName());
+			Snapshot.WritePickup(Pickup);
+			bBudgetLeft = FPlatformTime::Seconds() < EndTime;
+		}
+	}
+
+	CurrentCapture.CaptureSeconds += FPlatformTime::Seconds() - StartTime;
+	++CurrentCapture.CaptureFrames;
+
+	return CurrentCapture.NextCharacter == CurrentCapture.Characters.Num()
+		&& CurrentCapture.NextContainer == CurrentCapture.Containers.Num()
+		&& CurrentCapture.NextPickup == CurrentCapture.Pickups.Num();
+}
+
+void UWorldAutosaveSubsystem::WriteCapture()
+{
+	TSharedRef<FInventorySnapshotWriter, ESPMode::ThreadSafe> Snapshot = Capture->Snapshot.ToSharedRef();
+	TArray<FString> PlayerKeys = MoveTemp(Capture->PlayerKeys);
+	TArray<FString> ContainerKeys = MoveTemp(Capture->ContainerKeys);
+	TArray<FString> PickupKeys = MoveTemp(Capture->PickupKeys);
+	const double CaptureSeconds = Capture->CaptureSeconds;
+	const int32 CaptureFrames = Capture->CaptureFrames;
+	Capture.Reset();
+
+	const FString FilePath = GetSaveFilePath(NextSaveSlot);
+	NextSaveSlot = (NextSaveSlot + 1) % 2;
+
+	SaveTask = FFunctionGraphTask::CreateAndDispatchWhenReady([this, Snapshot, PlayerKeys = MoveTemp(PlayerKeys), ContainerKeys = MoveTemp(ContainerKeys), PickupKeys = MoveTemp(PickupKeys), FilePath, CaptureSeconds, CaptureFrames]() mutable
+	{
+		const double WriteStartTime = FPlatformTime::Seconds();
+
+		TArray<uint8> SnapshotData;
+		Snapshot->Finalize(SnapshotData);
+
+		TArray<uint8> UncompressedData;
+		FMemoryWriter UncompressedWriter(UncompressedData);
+		UncompressedWriter << PlayerKeys;
+		UncompressedWriter << ContainerKeys;
+		UncompressedWriter << PickupKeys;
+		UncompressedWriter << SnapshotData;
+
+		int32 CompressedSize = FCompression::CompressMemoryBound(NAME_Zlib, UncompressedData.Num());
+		TArray<uint8> FileData;
+		FMemoryWriter FileWriter(FileData);
+
+		uint32 Magic = WorldAutosaveMagic;
+		uint16 Version = WorldAutosaveVersion;
+		int32 UncompressedSize = UncompressedData.Num();
+		FileWriter << Magic;
+		FileWriter << Version;
+		FileWriter << UncompressedSize;
+
+		const int32 HeaderSize = FileData.Num();
+		FileData.AddUninitialized(CompressedSize);
+		if (!FCompression::CompressMemory(NAME_Zlib, FileData.GetData() + HeaderSize, CompressedSize, UncompressedData.GetData(), UncompressedData.Num()))
+		{
+			UE_LOG(LogTemp, Error, TEXT("Autosave couldn't compress %d bytes"), UncompressedData.Num());
+			return;
+		}
+		FileData.SetNum(HeaderSize + CompressedSize, false);
+
+		//Write next to the slot and swap it in so a crash mid write never corrupts the slot
+		const FString TempFilePath = FilePath + TEXT(".tmp");
+		const bool bSaved = FFileHelper::SaveArrayToFile(FileData, *TempFilePath) && IFileManager::Get().Move(*FilePath, *TempFilePath, true, true);
+
+		FWorldAutosaveStats Stats;
+		Stats.NumRecords = Snapshot->GetNumRecords();
+		Stats.CaptureSeconds = CaptureSeconds;
+		Stats.CaptureFrames = CaptureFrames;
+		Stats.WriteSeconds = FPlatformTime::Seconds() - WriteStartTime;
+		Stats.UncompressedBytes = UncompressedData.Num();
+		Stats.CompressedBytes = CompressedSize;
+
+		if (bSaved)
+		{
+			UE_LOG(LogTemp, Log, TEXT("Autosaved %d records to %s: capture %.2f ms on game thread over %d frames, encode and write %.2f ms in background, %d bytes (%d compressed)"),
+				Stats.NumRecords, *FilePath, Stats.CaptureSeconds * 1000.0, Stats.CaptureFrames, Stats.WriteSeconds * 1000.0, Stats.UncompressedBytes, Stats.CompressedBytes);
+		}
+		else
+		{
+			UE_LOG(LogTemp, Error, TEXT("Autosave couldn't write %s"), *FilePath);
+		}
+
+		FScopeLock StatsLock(&StatsCriticalSection);
+		LastStats = Stats;
+	}, TStatId(), nullptr, ENamedThreads::AnyBackgroundThreadNormalTask);
+}
+
+FWorldAutosaveStats UWorldAutosaveSubsystem::GetLastStats() const
+{
+	FScopeLock StatsLock(&StatsCriticalSection);
+	return LastStats;
+}
+
+FString UWorldAutosaveSubsystem::GetSaveFilePath(const int32 Slot) const
+{
+	const FString MapName = GetWorld() ? GetWorld()->GetMapName() : FString(TEXT("World"));
+	return FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Autosave"), FString::Printf(TEXT("%s_%d.sav"), *MapName, Slot));
+}
@@ -0,0 +1,111 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "WorldAutosaveSubsystem.generated.h"
+
+class ASurvivalCharacter;
+class ALootableActor;
+class APickup;
+class FInventorySnapshotWriter;
+
+//Timings of the last finished autosave
+struct FWorldAutosaveStats
+{
+	FWorldAutosaveStats() : NumRecords(0), CaptureSeconds(0.0), CaptureFrames(0), WriteSeconds(0.0), UncompressedBytes(0), CompressedBytes(0) {};
+
+	int32 NumRecords;
+	//Time spent on the game thread writing the snapshot records, summed over every frame of the capture
+	double CaptureSeconds;
+	//Frames the capture was spread over
+	int32 CaptureFrames;
+	//Time spent on a background worker encoding, compressing and writing the file
+	double WriteSeconds;
+	int32 UncompressedBytes;
+	int32 CompressedBytes;
+};
+
+//An autosave being captured, the actors to save are gathered up front and written a few at a time
+struct FWorldAutosaveCapture
+{
+	FWorldAutosaveCapture() : NextCharacter(0), NextContainer(0), NextPickup(0), CaptureSeconds(0.0), CaptureFrames(0) {};
+
+	TSharedPtr<FInventorySnapshotWriter, ESPMode::ThreadSafe> Snapshot;
+
+	TArray<TWeakObjectPtr<ASurvivalCharacter>> Characters;
+	TArray<TWeakObjectPtr<ALootableActor>> Containers;
+	TArray<TWeakObjectPtr<APickup>> Pickups;
+
+	int32 NextCharacter;
+	int32 NextContainer;
+	int32 NextPickup;
+
+	TArray<FString> PlayerKeys;
+	TArray<FString> ContainerKeys;
+	TArray<FString> PickupKeys;
+
+	double CaptureSeconds;
+	int32 CaptureFrames;
+};
+
+/**
+ * Periodically snapshots every loot container, pickup and player inventory on the server, once
+ * SurvivalGame.AutosaveInterval is set. The game thread writes the records over as many frames as
+ * SurvivalGame.AutosaveCaptureBudgetMs needs, so a save is not one point in time: an item moved
+ * between two actors during the capture can be saved in both or neither. Finalizing, compression
+ * and the file write happen on a background worker. Saves alternate between two files so the
+ * previous save stays intact while the next one is being written.
+ */
+UCLASS()
+class SURVIVALGAME_API UWorldAutosaveSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+
+	UWorldAutosaveSubsystem();
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+
+	/**Starts capturing the world, the capture finishes over the next frames and is then written in the background.
+	Returns false if a save is still being captured or written*/
+	bool RequestAutosave();
+
+	FORCEINLINE bool IsSaveInProgress() const { return Capture.IsValid() || (SaveTask.IsValid() && !SaveTask->IsComplete()); };
+
+	FWorldAutosaveStats GetLastStats() const;
+
+	//The file the next autosave goes to, alternates between two slots
+	FString GetSaveFilePath(const int32 Slot) const;
+
+protected:
+
+	bool bInitialized;
+
+	float TimeSinceLastSave;
+
+	int32 NextSaveSlot;
+
+	//Writes records until the frame's budget is spent, true once every gathered actor is in the snapshot
+	bool ContinueCapture();
+
+	//Hands the finished capture to a background worker
+	void WriteCapture();
+
+	TUniquePtr<FWorldAutosaveCapture> Capture;
+
+	FGraphEventRef SaveTask;
+
+	mutable FCriticalSection StatsCriticalSection;
+	FWorldAutosaveStats LastStats;
+};
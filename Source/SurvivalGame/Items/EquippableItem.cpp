@@ -65,6 +65,25 @@ void UEquippableItem::AddedToInventory(UInventoryComponent* Inventory)
 	}
 }
 
+bool UEquippableItem::CanUseCompactStorage() const
+{
+	//Equipped state and the slots the character fills need a real object
+	return false;
+}
+
+bool UEquippableItem::CanReturnToPool() const
+{
+	//The character still references equipped items through its equipped slots
+	return !bEquipped && Super::CanReturnToPool();
+}
+
+void UEquippableItem::ResetPooledState()
+{
+	Super::ResetPooledState();
+
+	bEquipped = false;
+}
+
 void UEquippableItem::SetEquipped(bool bNewEquipped)
 {
 	bEquipped = bNewEquipped;
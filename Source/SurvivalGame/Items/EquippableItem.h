@@ -44,9 +44,12 @@ public:
 
 	virtual bool ShouldShowInInventory() const override;
 	virtual void AddedToInventory(class UInventoryComponent* Inventory) override;
+	virtual bool CanUseCompactStorage() const override;
+	virtual bool CanReturnToPool() const override;
+	virtual void ResetPooledState() override;
 
 	UFUNCTION(BlueprintPure, Category = "Equippables")
-	bool IsEquipped() { return bEquipped; };
+	bool IsEquipped() const { return bEquipped; };
 
 	/** Call on server to equip the item*/
 	void SetEquipped(bool bNewEquipped);
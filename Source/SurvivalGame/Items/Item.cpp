@@ -48,10 +48,15 @@ UItem::UItem()
 	Quantity = 1;
 	MaxStackSize = 2;
 	RepKey = 0;
+	bCompactProxy = false;
 }
 
-void UItem::OnRep_Quantity()
+void UItem::OnRep_Quantity(int32 OldQuantity)
 {
+	if (OwningInventoryComponent)
+	{
+		OwningInventoryComponent->OnItemQuantityChanged(this, OldQuantity);
+	}
 	OnItemModified.Broadcast();
 }
 
@@ -59,7 +64,13 @@ void UItem::SetQuantity(const int32 NewQuantity)
 {
 	if (NewQuantity != Quantity)
 	{
+		const int32 OldQuantity = Quantity;
 		Quantity = FMath::Clamp(NewQuantity, 0, bStackable ? MaxStackSize : 1);
+
+		if (OwningInventoryComponent)
+		{
+			OwningInventoryComponent->OnItemQuantityChanged(this, OldQuantity);
+		}
 		MarkDirtyForReplication();
 	}
 }
@@ -84,8 +95,30 @@ void UItem::MarkDirtyForReplication()
 	++RepKey;
 	if (OwningInventoryComponent)
 	{
-		++OwningInventoryComponent->ReplicatedItemsKey;
+		OwningInventoryComponent->MarkItemsDirty();
 	}
 }
 
+bool UItem::CanUseCompactStorage() const
+{
+	return bStackable;
+}
+
+bool UItem::CanReturnToPool() const
+{
+	return true;
+}
+
+void UItem::ResetPooledState()
+{
+	Quantity = GetClass()->GetDefaultObject<UItem>()->Quantity;
+	OwningInventoryComponent = nullptr;
+	World = nullptr;
+	bCompactProxy = false;
+	OnItemModified.Clear();
+
+	//RepKey keeps counting up so no channel ever mistakes the reused item for one it already replicated
+	++RepKey;
+}
+
 #undef LOCTEXT_NAMESPACE 
\ No newline at end of file
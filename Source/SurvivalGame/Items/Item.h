@@ -82,11 +82,15 @@ public:
 	UPROPERTY()
 	int32 RepKey;
 
+	//Set on the local stand in of a compact inventory stack. Those are never replicated, so RPCs refer to them by class
+	UPROPERTY(Transient)
+	bool bCompactProxy;
+
 	UPROPERTY(BlueprintAssignable)
 	FOnItemModified OnItemModified;
 
 	UFUNCTION()
-	void OnRep_Quantity();
+	void OnRep_Quantity(int32 OldQuantity);
 
 	UFUNCTION(BlueprintCallable, Category = "Item")
 	void SetQuantity(const int32 NewQuantity);
@@ -107,4 +111,13 @@ public:
 	void OnUse(class ASurvivalCharacter* Character);
 
 	void MarkDirtyForReplication();
+
+	/**Whether inventories may store this item as just a class and quantity. Anything that needs its own identity must return false*/
+	virtual bool CanUseCompactStorage() const;
+
+	/**Whether the item pool may take this item back once it has left its inventory or pickup*/
+	virtual bool CanReturnToPool() const;
+
+	/**Called by the item pool when the item is released. Subclasses clear any per instance state here*/
+	virtual void ResetPooledState();
 };
@@ -0,0 +1,174 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "ItemPoolSubsystem.h"
+#include "Items/Item.h"
+#include "Engine/World.h"
+#include "Engine/NetDriver.h"
+#include "Engine/PackageMapClient.h"
+
+static const ERenameFlags PooledItemRenameFlags = REN_DontCreateRedirectors | REN_DoNotDirty | REN_NonTransactional | REN_ForceNoResetLoaders;
+
+UItemPoolSubsystem::UItemPoolSubsystem()
+{
+	MaxPooledItemsPerClass = 64;
+	bInitialized = false;
+
+	NumAcquired = 0;
+	NumReused = 0;
+	NumRejectedNetAddressable = 0;
+}
+
+void UItemPoolSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	bInitialized = true;
+}
+
+void UItemPoolSubsystem::Deinitialize()
+{
+	if (NumAcquired > 0)
+	{
+		UE_LOG(LogTemp, Log, TEXT("Item pool: %d of %d acquires reused a pooled item, %d releases were rejected as net addressable"), NumReused, NumAcquired, NumRejectedNetAddressable);
+	}
+
+	bInitialized = false;
+	PendingReleases.Empty();
+	Pools.Empty();
+
+	Super::Deinitialize();
+}
+
+ETickableTickType UItemPoolSubsystem::GetTickableTickType() const
+{
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+bool UItemPoolSubsystem::IsTickable() const
+{
+	return bInitialized && PendingReleases.Num() > 0;
+}
+
+TStatId UItemPoolSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UItemPoolSubsystem, STATGROUP_Tickables);
+}
+
+void UItemPoolSubsystem::Tick(float DeltaTime)
+{
+	//Releases from this frame's tickables run after the world tick wait for the next one
+	int32 NumReady = 0;
+	while (NumReady < PendingReleases.Num() && PendingReleases[NumReady].ReleaseFrame < GFrameCounter)
+	{
+		++NumReady;
+	}
+
+	for (int32 i = 0; i < NumReady; ++i)
+	{
+		UItem* Item = PendingReleases[i].Item;
+
+		//Put back into an inventory before the frame ended, it's in use again
+		if (Item && !Item->OwningInventoryComponent)
+		{
+			ReleaseImmediate(Item);
+		}
+	}
+	PendingReleases.RemoveAt(0, NumReady, false);
+}
+
+UItem* UItemPoolSubsystem::AcquireItem(const UWorld* World, TSubclassOf<UItem> ItemClass, UObject* Outer)
+{
+	if (UItemPoolSubsystem* ItemPool = World ? World->GetSubsystem<UItemPoolSubsystem>() : nullptr)
+	{
+		return ItemPool->Acquire(ItemClass, Outer);
+	}
+	return ItemClass ? NewObject<UItem>(Outer, ItemClass) : nullptr;
+}
+
+void UItemPoolSubsystem::ReleaseItem(const UWorld* World, UItem* Item)
+{
+	if (UItemPoolSubsystem* ItemPool = World ? World->GetSubsystem<UItemPoolSubsystem>() : nullptr)
+	{
+		ItemPool->Release(Item);
+	}
+}
+
+void UItemPoolSubsystem::ReleaseItemImmediate(const UWorld* World, UItem* Item)
+{
+	if (UItemPoolSubsystem* ItemPool = World ? World->GetSubsystem<UItemPoolSubsystem>() : nullptr)
+	{
+		ItemPool->ReleaseImmediate(Item);
+	}
+}
+
+UItem* UItemPoolSubsystem::Acquire(TSubclassOf<UItem> ItemClass, UObject* Outer)
+{
+	if (!ItemClass)
+	{
+		return nullptr;
+	}
+
+	++NumAcquired;
+
+	if (FItemPool* Pool = Pools.Find(ItemClass))
+	{
+		while (Pool->FreeItems.Num())
+		{
+			UItem* Item = Pool->FreeItems.Pop(false);
+			if (Item && !Item->IsPendingKill())
+			{
+				++NumReused;
+
+				Item->Rename(nullptr, Outer, PooledItemRenameFlags);
+				Item->World = GetWorld();
+				return Item;
+			}
+		}
+	}
+
+	UItem* Item = NewObject<UItem>(Outer, ItemClass);
+	Item->World = GetWorld();
+	return Item;
+}
+
+void UItemPoolSubsystem::Release(UItem* Item)
+{
+	if (Item && !Item->IsPendingKill())
+	{
+		PendingReleases.Emplace(Item, GFrameCounter);
+	}
+}
+
+void UItemPoolSubsystem::ReleaseImmediate(UItem* Item)
+{
+	if (!Item || Item->IsPendingKill() || !Item->CanReturnToPool())
+	{
+		return;
+	}
+
+	if (IsNetAddressable(Item))
+	{
+		++NumRejectedNetAddressable;
+		return;
+	}
+
+	FItemPool& Pool = Pools.FindOrAdd(Item->GetClass());
+	if (Pool.FreeItems.Num() < MaxPooledItemsPerClass && !Pool.FreeItems.Contains(Item))
+	{
+		Item->ResetPooledState();
+		Item->Rename(nullptr, this, PooledItemRenameFlags);
+		Pool.FreeItems.Add(Item);
+	}
+}
+
+bool UItemPoolSubsystem::IsNetAddressable(const UItem* Item) const
+{
+	if (UNetDriver* NetDriver = GetWorld() ? GetWorld()->GetNetDriver() : nullptr)
+	{
+		if (NetDriver->GuidCache.IsValid())
+		{
+			return NetDriver->GuidCache->NetGUIDLookup.Contains(const_cast<UItem*>(Item));
+		}
+	}
+	return false;
+}
@@ -0,0 +1,104 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "ItemPoolSubsystem.generated.h"
+
+class UItem;
+
+USTRUCT()
+struct FItemPool
+{
+	GENERATED_BODY()
+
+public:
+
+	UPROPERTY()
+	TArray<UItem*> FreeItems;
+};
+
+//An item handed back this frame, it only joins the pool once the frame it was released in has ended
+USTRUCT()
+struct FPendingItemRelease
+{
+	GENERATED_BODY()
+
+public:
+
+	FPendingItemRelease() : Item(nullptr), ReleaseFrame(0) {};
+	FPendingItemRelease(UItem* InItem, uint64 InReleaseFrame) : Item(InItem), ReleaseFrame(InReleaseFrame) {};
+
+	UPROPERTY()
+	UItem* Item;
+
+	uint64 ReleaseFrame;
+};
+
+/**
+ * Per world pool of UItem instances keyed by item class, so items that never went over the network reuse
+ * objects instead of allocating new ones for the GC to sweep. That covers standalone games, temporaries that
+ * are merged into existing stacks and client side stand ins of compact stacks. Items a networked server has
+ * replicated keep their NetGUID for as long as they live and are left to the GC, see IsNetAddressable.
+ * On a dedicated server that leaves little more than the temporaries of TryAddItemFromClass, so expect a low hit
+ * rate there. The counts are logged when the world shuts down.
+ *
+ * Released items are held back until the frame they were released in has ended, callers and OnItemRemoved
+ * listeners may still be looking at them until then.
+ */
+UCLASS()
+class SURVIVALGAME_API UItemPoolSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+
+	UItemPoolSubsystem();
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+
+	/**Returns an item of ItemClass owned by Outer, reusing a pooled instance when there is one.
+	Falls back to NewObject when the world has no pool.*/
+	static UItem* AcquireItem(const UWorld* World, TSubclassOf<UItem> ItemClass, UObject* Outer);
+
+	/**Hands an item back to the pool of its world once the current frame has ended. Nothing may keep the item past this frame.*/
+	static void ReleaseItem(const UWorld* World, UItem* Item);
+
+	/**Pools the item straight away, only for temporaries that were never handed to anything else.*/
+	static void ReleaseItemImmediate(const UWorld* World, UItem* Item);
+
+	UItem* Acquire(TSubclassOf<UItem> ItemClass, UObject* Outer);
+	void Release(UItem* Item);
+	void ReleaseImmediate(UItem* Item);
+
+protected:
+
+	/**Items a net driver has assigned a guid to can't be reused, remote machines would resolve the guid to the old object.
+	The guid cache keeps the mapping until the object is destroyed, so on a listen or dedicated server this rules out
+	nearly every item that was ever in a replicated inventory or pickup.*/
+	bool IsNetAddressable(const UItem* Item) const;
+
+	UPROPERTY()
+	TMap<UClass*, FItemPool> Pools;
+
+	UPROPERTY()
+	TArray<FPendingItemRelease> PendingReleases;
+
+	bool bInitialized;
+
+	int32 NumAcquired;
+	int32 NumReused;
+	int32 NumRejectedNetAddressable;
+
+	//Max amount of free items kept around for each item class
+	UPROPERTY()
+	int32 MaxPooledItemsPerClass;
+};
@@ -5,5 +5,11 @@
 
 UThrowableItem::UThrowableItem()
 {
-		
+	bSimulateAsProjectile = false;
+
+	ProjectileConfig.InitialSpeed = 1000.f;
+	ProjectileConfig.Radius = 5.f;
+	ProjectileConfig.MaxBounces = 3;
+	ProjectileConfig.bDetonateOnImpact = false;
+	ProjectileConfig.Damage = 0.f;
 }
\ No newline at end of file
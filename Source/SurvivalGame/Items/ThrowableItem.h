@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "Items/EquippableItem.h"
+#include "Weapons/ProjectileSubsystem.h"
 #include "ThrowableItem.generated.h"
 
 /**
@@ -23,4 +24,11 @@ public:
 
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Weapons")
 	TSubclassOf<class AThrowableWeapon> ThrowableWeaponClass;
+
+	//Throw a simulated projectile instead of spawning ThrowableWeaponClass
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Weapons")
+	bool bSimulateAsProjectile;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Weapons", meta = (EditCondition = "bSimulateAsProjectile"))
+	FProjectileConfig ProjectileConfig;
 };
@@ -7,6 +7,7 @@
 #include "Components/CapsuleComponent.h"
 #include "Components/InteractionComponent.h"
 #include "Components/InventoryComponent.h"
+#include "Components/InteractionSubsystem.h"
 #include "Components/SkeletalMeshComponent.h"
 #include "GameFramework/CharacterMovementComponent.h"
 #include "GameFramework/DamageType.h"
@@ -23,6 +24,8 @@
 #include "../Weapons/ThrowableWeapon.h"
 #include "../Weapons/MeleeDamage.h"
 #include "../Weapons/Weapon.h"
+#include "../Weapons/LagCompensationSubsystem.h"
+#include "../Weapons/ProjectileSubsystem.h"
 
 #define LOCTEXT_NAMESPACE "SurvivalCharacter"
 
@@ -65,6 +68,7 @@ ASurvivalCharacter::ASurvivalCharacter()
 	PlayerInventoryComponent = CreateDefaultSubobject<UInventoryComponent>("PlayerInventoryComponent");
 	PlayerInventoryComponent->SetCapacity(20);
 	PlayerInventoryComponent->SetCapacity(80.f);
+	PlayerInventoryComponent->SetUseCompactStorage(true);
 
 	LootPlayerInteractionComponent = CreateDefaultSubobject<UInteractionComponent>("LootPlayerInteractionComponent");
 	LootPlayerInteractionComponent->InteractableActionText = (LOCTEXT("LootPlayerText", "Loot"));
@@ -74,6 +78,7 @@ ASurvivalCharacter::ASurvivalCharacter()
 	LootPlayerInteractionComponent->bAutoActivate = false;
 
 	bIsAiming = false;
+	InteractPredictionKey = 0;
 
 	InteractionCheckDistance = 1000.f;
 	InteractionCheckFrequency = 0.5f;
@@ -107,6 +112,25 @@ void ASurvivalCharacter::BeginPlay()
 	{
 		NakedMeshes.Add(PlayerMesh.Key, PlayerMesh.Value->SkeletalMesh);
 	}
+
+	//The server keeps our recent hitboxes around to check other players' shots against
+	if (HasAuthority())
+	{
+		if (ULagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<ULagCompensationSubsystem>())
+		{
+			LagCompensation->RegisterCharacter(this);
+		}
+	}
+}
+
+void ASurvivalCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (ULagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<ULagCompensationSubsystem>())
+	{
+		LagCompensation->UnregisterCharacter(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
 }
 
 void ASurvivalCharacter::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
@@ -155,19 +179,40 @@ void ASurvivalCharacter::SetupPlayerInputComponent(UInputComponent* PlayerInputC
 
 bool ASurvivalCharacter::IsInteracting() const
 {
-	return GetWorldTimerManager().IsTimerActive(TimerHandle_Interact);
+	const UInteractionSubsystem* InteractionSubsystem = InteractHandle.IsValid() ? GetWorld()->GetSubsystem<UInteractionSubsystem>() : nullptr;
+	return InteractionSubsystem && InteractionSubsystem->IsInteractionScheduled(InteractHandle);
 }
 
 float ASurvivalCharacter::GetRemainingInteractionTime() const
 {
-	return GetWorldTimerManager().GetTimerRemaining(TimerHandle_Interact);
+	const UInteractionSubsystem* InteractionSubsystem = InteractHandle.IsValid() ? GetWorld()->GetSubsystem<UInteractionSubsystem>() : nullptr;
+	return InteractionSubsystem ? InteractionSubsystem->GetInteractionTimeRemaining(InteractHandle) : -1.f;
+}
+
+void ASurvivalCharacter::CancelScheduledInteract()
+{
+	if (InteractHandle.IsValid())
+	{
+		if (UInteractionSubsystem* InteractionSubsystem = GetWorld()->GetSubsystem<UInteractionSubsystem>())
+		{
+			InteractionSubsystem->CancelInteraction(InteractHandle);
+		}
+		InteractHandle.Invalidate();
+	}
 }
 
 void ASurvivalCharacter::UseItem(UItem* Item)
 {
 	if (GetLocalRole() < ROLE_Authority && Item)
 	{
-		ServerUseItem(Item);
+		if (Item->bCompactProxy)
+		{
+			ServerUseItemByClass(Item->GetClass());
+		}
+		else
+		{
+			ServerUseItem(Item);
+		}
 	}
 	if (HasAuthority())
 	{
@@ -193,18 +238,40 @@ bool ASurvivalCharacter::ServerUseItem_Validate(UItem* Item)
 	return true;
 }
 
+void ASurvivalCharacter::ServerUseItemByClass_Implementation(TSubclassOf<UItem> ItemClass)
+{
+	if (PlayerInventoryComponent)
+	{
+		UseItem(PlayerInventoryComponent->GetOrCreateItemObject(ItemClass));
+	}
+}
+
+bool ASurvivalCharacter::ServerUseItemByClass_Validate(TSubclassOf<UItem> ItemClass)
+{
+	return true;
+}
+
 void ASurvivalCharacter::DropItem(UItem* Item, const int32 Quantity)
 {
 	if (PlayerInventoryComponent && Item && PlayerInventoryComponent->FindItem(Item))
 	{
 		if (GetLocalRole() < ROLE_Authority)
 		{
-			ServerDropItem(Item, Quantity);
+			if (Item->bCompactProxy)
+			{
+				ServerDropItemByClass(Item->GetClass(), Quantity);
+			}
+			else
+			{
+				ServerDropItem(Item, Quantity);
+			}
 			return;
 		}			
 		if (HasAuthority())
 		{
 			const int32 ItemQuantity = Item->GetQuantity();
+			//Consuming the last of the stack hands the item back to the pool, so grab the class first
+			const TSubclassOf<UItem> ItemClass = Item->GetClass();
 			const int32 DroppedQuantity = PlayerInventoryComponent->ConsumeItem(Item, Quantity);
 
 			FActorSpawnParameters SpawnParams;
@@ -219,7 +286,7 @@ void ASurvivalCharacter::DropItem(UItem* Item, const int32 Quantity)
 			ensure(PickupClass);
 
 			APickup* Pickup = GetWorld()->SpawnActor<APickup>(PickupClass, SpawnTransform, SpawnParams);
-			Pickup->InitializePickup(Item->GetClass(), DroppedQuantity);
+			Pickup->InitializePickup(ItemClass, DroppedQuantity);
 
 		}
 	}
@@ -235,6 +302,19 @@ bool ASurvivalCharacter::ServerDropItem_Validate(UItem* Item, const int32 Quanti
 	return true;
 }
 
+void ASurvivalCharacter::ServerDropItemByClass_Implementation(TSubclassOf<UItem> ItemClass, const int32 Quantity)
+{
+	if (PlayerInventoryComponent)
+	{
+		DropItem(PlayerInventoryComponent->GetOrCreateItemObject(ItemClass), Quantity);
+	}
+}
+
+bool ASurvivalCharacter::ServerDropItemByClass_Validate(TSubclassOf<UItem> ItemClass, const int32 Quantity)
+{
+	return true;
+}
+
 // Called every frame
 void ASurvivalCharacter::Tick(float DeltaTime)
 {
@@ -396,6 +476,10 @@ void ASurvivalCharacter::LootItem(UItem* ItemToGive)
 			}
 		}
 	}
+	else if (ItemToGive && ItemToGive->bCompactProxy)
+	{
+		ServerLootItemByClass(ItemToGive->GetClass());
+	}
 	else
 	{
 		ServerLootItem(ItemToGive);
@@ -412,45 +496,94 @@ bool ASurvivalCharacter::ServerLootItem_Validate(UItem* ItemToLoot)
 	return true;
 }
 
+void ASurvivalCharacter::ServerLootItemByClass_Implementation(TSubclassOf<UItem> ItemClassToLoot)
+{
+	if (LootSource)
+	{
+		LootItem(LootSource->GetOrCreateItemObject(ItemClassToLoot));
+	}
+}
+
+bool ASurvivalCharacter::ServerLootItemByClass_Validate(TSubclassOf<UItem> ItemClassToLoot)
+{
+	return true;
+}
+
 void ASurvivalCharacter::PerformInteractionCheck()
 {
 	if (GetController() == nullptr) { return; }
 
 	InteractionData.LastInterationCheckTime = GetWorld()->GetTimeSeconds();
 
-	FVector EyesLoc;
-	FRotator EyesRot;
+	UInteractionSubsystem* InteractionSubsystem = GetWorld()->GetSubsystem<UInteractionSubsystem>();
 
-	GetController()->GetPlayerViewPoint(EyesLoc, EyesRot);
+	//Remote players are checked by the server in one batch with everyone else
+	if (InteractionSubsystem && HasAuthority() && !IsLocallyControlled())
+	{
+		InteractionSubsystem->RequestInteractionCheck(this, false);
+		return;
+	}
+
+	FVector TraceStart;
+	FVector TraceEnd;
+	GetInteractionTrace(TraceStart, TraceEnd);
 
-	const FVector TraceStart = EyesLoc;
-	const FVector TraceEnd = (EyesRot.Vector() * InteractionCheckDistance) + EyesLoc;
+	//Only pay for the trace when something interactable could actually be under the crosshair
+	if (InteractionSubsystem)
+	{
+		if (!InteractionSubsystem->FindCandidatesInView(TraceStart, (TraceEnd - TraceStart).GetSafeNormal(), InteractionCheckDistance, this))
+		{
+			CouldntFindInteractable();
+			return;
+		}
+	}
 
 	FHitResult OUT TraceHit;
 
 	FCollisionQueryParams QueryParams;
 	QueryParams.AddIgnoredActor(this);
 
-	if (GetWorld()->LineTraceSingleByChannel(TraceHit, TraceStart, TraceEnd, ECC_Visibility, QueryParams))
+	const bool bHit = GetWorld()->LineTraceSingleByChannel(TraceHit, TraceStart, TraceEnd, ECC_Visibility, QueryParams);
+	ProcessInteractionHit(bHit ? &TraceHit : nullptr, TraceStart);
+}
+
+bool ASurvivalCharacter::GetInteractionTrace(FVector& OutTraceStart, FVector& OutTraceEnd) const
+{
+	if (GetController() == nullptr) { return false; }
+
+	FVector EyesLoc;
+	FRotator EyesRot;
+
+	GetController()->GetPlayerViewPoint(EyesLoc, EyesRot);
+
+	OutTraceStart = EyesLoc;
+	OutTraceEnd = (EyesRot.Vector() * InteractionCheckDistance) + EyesLoc;
+	return true;
+}
+
+void ASurvivalCharacter::ProcessInteractionHit(const FHitResult* Hit, const FVector& TraceStart)
+{
+	if (Hit && Hit->GetActor())
 	{
-		if (TraceHit.GetActor())
-		{
-			if (UInteractionComponent* InteractionComponent = Cast<UInteractionComponent>(TraceHit.GetActor()->GetComponentByClass(UInteractionComponent::StaticClass())))
-			{
-				float distance = (TraceStart - TraceHit.ImpactPoint).Size();
+		UInteractionSubsystem* InteractionSubsystem = GetWorld()->GetSubsystem<UInteractionSubsystem>();
+		UInteractionComponent* InteractionComponent = InteractionSubsystem ? InteractionSubsystem->FindInteractableForActor(Hit->GetActor())
+			: Cast<UInteractionComponent>(Hit->GetActor()->GetComponentByClass(UInteractionComponent::StaticClass()));
 
-				if (InteractionComponent != GetInteracable() && distance <= InteractionComponent->InteractionDistance)
-				{
-					FoundNewInteractable(InteractionComponent);
-				}
+		if (InteractionComponent)
+		{
+			float distance = (TraceStart - Hit->ImpactPoint).Size();
 
-				else if (distance > InteractionComponent->InteractionDistance && GetInteracable())
-				{
-					CouldntFindInteractable();
-				}
+			if (InteractionComponent != GetInteracable() && distance <= InteractionComponent->InteractionDistance)
+			{
+				FoundNewInteractable(InteractionComponent);
+			}
 
-				return;
+			else if (distance > InteractionComponent->InteractionDistance && GetInteracable())
+			{
+				CouldntFindInteractable();
 			}
+
+			return;
 		}
 	}
 	CouldntFindInteractable();
@@ -471,11 +604,8 @@ void ASurvivalCharacter::FoundNewInteractable(UInteractionComponent* Interactabl
 
 void ASurvivalCharacter::CouldntFindInteractable()
 {
-	if (GetWorldTimerManager().IsTimerActive(TimerHandle_Interact))
-	{
-		GetWorldTimerManager().ClearTimer(TimerHandle_Interact);
-	}
-	
+	CancelScheduledInteract();
+
 	if (UInteractionComponent* Interactable = GetInteracable())
 	{
 		Interactable->EndFocus(this);
@@ -490,8 +620,23 @@ void ASurvivalCharacter::CouldntFindInteractable()
 
 void ASurvivalCharacter::BeginInteract()
 {
-	if (!HasAuthority()) { ServerBeginInteract(); }
+	if (!HasAuthority()) { ServerBeginInteract(++InteractPredictionKey); }
+
+	//The server finishes beginning the interaction once the batched check has traced what the player is looking at
+	UInteractionSubsystem* InteractionSubsystem = GetWorld()->GetSubsystem<UInteractionSubsystem>();
+	if (InteractionSubsystem && HasAuthority() && !IsLocallyControlled())
+	{
+		InteractionData.bInteractableHeld = true;
+		InteractionSubsystem->RequestInteractionCheck(this, true);
+		return;
+	}
+
 	if (HasAuthority()) { PerformInteractionCheck(); }
+	FinishBeginInteract();
+}
+
+void ASurvivalCharacter::FinishBeginInteract()
+{
 	InteractionData.bInteractableHeld = true;
 	if (UInteractionComponent* Interactable = GetInteracable())
 	{
@@ -503,7 +648,11 @@ void ASurvivalCharacter::BeginInteract()
 		}
 		else
 		{
-			GetWorldTimerManager().SetTimer(TimerHandle_Interact, this, &ASurvivalCharacter::Interact, Interactable->InteractionTime, false);
+			CancelScheduledInteract();
+			if (UInteractionSubsystem* InteractionSubsystem = GetWorld()->GetSubsystem<UInteractionSubsystem>())
+			{
+				InteractHandle = InteractionSubsystem->ScheduleInteraction(this, Interactable->InteractionTime);
+			}
 		}
 	}
 }
@@ -513,7 +662,7 @@ void ASurvivalCharacter::EndInteract()
 	if (!HasAuthority()) { ServerEndInteract(); }
 	InteractionData.bInteractableHeld = false;
 
-	GetWorldTimerManager().ClearTimer(TimerHandle_Interact);
+	CancelScheduledInteract();
 
 	if (UInteractionComponent* Interactable = GetInteracable())
 	{
@@ -521,19 +670,37 @@ void ASurvivalCharacter::EndInteract()
 	}
 }
 
-void ASurvivalCharacter::ServerBeginInteract_Implementation()
+void ASurvivalCharacter::ServerBeginInteract_Implementation(const int32 PredictionKey)
 {
+	InteractPredictionKey = PredictionKey;
 	BeginInteract();
 }
 
-bool ASurvivalCharacter::ServerBeginInteract_Validate()
+bool ASurvivalCharacter::ServerBeginInteract_Validate(const int32 PredictionKey)
 {
-	return true;
+	return PredictionKey > 0;
 }
 
 void ASurvivalCharacter::ServerEndInteract_Implementation()
+{
+	//A begin still waiting on its trace has to happen first, a quick tap on an instant interaction would be lost otherwise
+	UInteractionSubsystem* InteractionSubsystem = GetWorld()->GetSubsystem<UInteractionSubsystem>();
+	if (InteractionSubsystem && InteractionSubsystem->DeferEndInteract(this))
+	{
+		return;
+	}
+	FinishEndInteract(InteractPredictionKey);
+}
+
+void ASurvivalCharacter::FinishEndInteract(const int32 PredictionKey)
 {
 	EndInteract();
+
+	//Nothing was taken for the interaction, let the client roll back whatever it predicted. A newer begin keeps its key
+	if (PlayerInventoryComponent && InteractPredictionKey == PredictionKey)
+	{
+		PlayerInventoryComponent->AcknowledgePrediction(ConsumeInteractPredictionKey(), 0);
+	}
 }
 
 bool ASurvivalCharacter::ServerEndInteract_Validate()
@@ -541,9 +708,16 @@ bool ASurvivalCharacter::ServerEndInteract_Validate()
 	return true;
 }
 
+int32 ASurvivalCharacter::ConsumeInteractPredictionKey()
+{
+	const int32 PredictionKey = InteractPredictionKey;
+	InteractPredictionKey = 0;
+	return PredictionKey;
+}
+
 void ASurvivalCharacter::Interact()
 {
-	GetWorldTimerManager().ClearTimer(TimerHandle_Interact);
+	CancelScheduledInteract();
 	if (UInteractionComponent* Interactable = GetInteracable())
 	{
 		Interactable->Interact(this);
@@ -665,6 +839,17 @@ void ASurvivalCharacter::MulticastPlayThrowableFX_Implementation(UAnimMontage* M
 	}
 }
 
+void ASurvivalCharacter::MulticastLaunchThrowable_Implementation(const FProjectileSeed& Seed)
+{
+	if (!HasAuthority())
+	{
+		if (UProjectileSubsystem* Projectiles = GetWorld()->GetSubsystem<UProjectileSubsystem>())
+		{
+			Projectiles->LaunchProjectile(Seed);
+		}
+	}
+}
+
 UThrowableItem* ASurvivalCharacter::GetThrowable() const
 {
 	UThrowableItem* EquippedThrowable = nullptr;
@@ -712,7 +897,28 @@ void ASurvivalCharacter::SpawnThrowable()
 	{
 		if (UThrowableItem* CurrentThrowable = GetThrowable())
 		{
-			if (CurrentThrowable->ThrowableWeaponClass)
+			if (CurrentThrowable->bSimulateAsProjectile)
+			{
+				FVector EyesLoc;
+				FRotator EyesRot;
+
+				GetController()->GetPlayerViewPoint(EyesLoc, EyesRot);
+
+				FProjectileSeed Seed;
+				Seed.Origin = EyesLoc + (EyesRot.Vector() * 20.f);
+				Seed.Direction = EyesRot.Vector();
+				Seed.LaunchTime = ULagCompensationSubsystem::GetShotTime(GetWorld());
+				Seed.ConfigSource = CurrentThrowable->GetClass();
+				Seed.Causer = this;
+
+				UProjectileSubsystem* Projectiles = GetWorld()->GetSubsystem<UProjectileSubsystem>();
+				if (Projectiles && Projectiles->LaunchProjectile(Seed))
+				{
+					MulticastLaunchThrowable(Seed);
+					MulticastPlayThrowableFX(CurrentThrowable->ThrowableTossAnimation);
+				}
+			}
+			else if (CurrentThrowable->ThrowableWeaponClass)
 			{
 				FActorSpawnParameters SpawnParams;
 				SpawnParams.Owner = SpawnParams.Instigator = this;
@@ -737,7 +943,7 @@ void ASurvivalCharacter::SpawnThrowable()
 
 bool ASurvivalCharacter::CanUseThrowable() const
 {
-	return GetThrowable() != nullptr && GetThrowable()->ThrowableWeaponClass != nullptr;
+	return GetThrowable() != nullptr && (GetThrowable()->ThrowableWeaponClass != nullptr || GetThrowable()->bSimulateAsProjectile);
 }
 
 float ASurvivalCharacter::ModifyHealth(const float Delta)
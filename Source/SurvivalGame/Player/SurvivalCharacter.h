@@ -4,6 +4,8 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Character.h"
+#include "Components/InteractionSubsystem.h"
+#include "Weapons/ProjectileSubsystem.h"
 #include "SurvivalCharacter.generated.h"
 
 class USkeletalMeshComponent;
@@ -59,9 +61,12 @@ class SURVIVALGAME_API ASurvivalCharacter : public ACharacter
 
 		UFUNCTION(BlueprintCallable, Category = "items") void UseItem(class UItem* Item);
 		UFUNCTION(Server, Reliable, WithValidation)	void ServerUseItem(class UItem* Item);
+		//Compact inventory stacks only exist locally on the client, so the server is told which class to use instead
+		UFUNCTION(Server, Reliable, WithValidation)	void ServerUseItemByClass(TSubclassOf<class UItem> ItemClass);
 		
 		UFUNCTION(BlueprintCallable, Category = "items") void DropItem(class UItem* Item, const int32 Quantity);
 		UFUNCTION(Server, Reliable, WithValidation)	void ServerDropItem(class UItem* Item, const int32 Quantity);
+		UFUNCTION(Server, Reliable, WithValidation)	void ServerDropItemByClass(TSubclassOf<class UItem> ItemClass, const int32 Quantity);
 
 		UFUNCTION(BlueprintCallable, Category = "items") float ModifyHealth(const float Delta);
 
@@ -90,18 +95,35 @@ class SURVIVALGAME_API ASurvivalCharacter : public ACharacter
 			void LootItem(class UItem* ItemToGive);
 		UFUNCTION(Server, Reliable, WithValidation)
 			void ServerLootItem(class UItem* ItemToLoot);
+		UFUNCTION(Server, Reliable, WithValidation)
+			void ServerLootItemByClass(TSubclassOf<class UItem> ItemClassToLoot);
 		/*---------------------~Looting~---------------------*/
 
 		/*---------------------+Interaction+---------------------*/
 		void PerformInteractionCheck();
+		//Where the interaction trace runs from and to, false without a controller
+		bool GetInteractionTrace(FVector& OutTraceStart, FVector& OutTraceEnd) const;
+		//Focuses or unfocuses interactables based on what the interaction trace hit, Hit is null if nothing was hit
+		void ProcessInteractionHit(const FHitResult* Hit, const FVector& TraceStart);
 		void FoundNewInteractable(UInteractionComponent* Interactable);
 		void CouldntFindInteractable();
 		void BeginInteract();
+		//Second half of BeginInteract, once the server knows what the player is looking at
+		void FinishBeginInteract();
 		void EndInteract();
-		UFUNCTION(Server, Reliable, WithValidation)	void ServerBeginInteract();
+		UFUNCTION(Server, Reliable, WithValidation)	void ServerBeginInteract(const int32 PredictionKey);
 		UFUNCTION(Server, Reliable, WithValidation)	void ServerEndInteract();
+		//Server side end of the interaction begun under PredictionKey, rolls back its prediction if nothing was given for it
+		void FinishEndInteract(const int32 PredictionKey);
 
 		void Interact();
+		//Takes the hold interaction out of the interaction subsystem's schedule
+		void CancelScheduledInteract();
+
+		//Key the current interaction's predicted results are filed under, 0 if there is none
+		FORCEINLINE int32 GetInteractPredictionKey() const { return InteractPredictionKey; };
+		//Server side, hands out the key of the current interaction once so only the first result acknowledges it
+		int32 ConsumeInteractPredictionKey();
 		/*---------------------~Interaction~---------------------*/
 
 		/*---------------------+Items+---------------------*/
@@ -131,6 +153,8 @@ class SURVIVALGAME_API ASurvivalCharacter : public ACharacter
 		bool CanUseThrowable() const;
 		UFUNCTION(Server, Reliable)	void ServerUseThrowable();
 		UFUNCTION(NetMulticast, UnReliable) void MulticastPlayThrowableFX(class UAnimMontage* MontageToPlay);
+		//Throwables that are simulated as projectiles only send their seed
+		UFUNCTION(NetMulticast, Reliable) void MulticastLaunchThrowable(const FProjectileSeed& Seed);
 		/*---------------------~Items~---------------------*/
 
 
@@ -139,6 +163,7 @@ class SURVIVALGAME_API ASurvivalCharacter : public ACharacter
 
 	protected:
 		virtual void BeginPlay() override;
+		virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 		virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
 		virtual void Tick(float DeltaTime) override;
 		
@@ -213,7 +238,11 @@ class SURVIVALGAME_API ASurvivalCharacter : public ACharacter
 		UPROPERTY(EditAnywhere, Category = "Components")
 			USkeletalMeshComponent* BackpackMesh;
 
-		FTimerHandle TimerHandle_Interact;
+		//The hold interaction scheduled with the interaction subsystem
+		FInteractionHandle InteractHandle;
+
+		//On the owning client the key of the interaction it last began, on the server the one it hasn't acknowledged yet
+		int32 InteractPredictionKey;
 		//Information about the current state of the player
 		UPROPERTY() FInteractionData InteractionData;
 
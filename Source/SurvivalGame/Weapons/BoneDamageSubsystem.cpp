@@ -0,0 +1,92 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "BoneDamageSubsystem.h"
+
+#include "Weapons/Weapon.h"
+#include "Weapons/LagCompensationSubsystem.h"
+
+#include "Engine/SkeletalMesh.h"
+#include "Engine/World.h"
+#include "UObject/UObjectGlobals.h"
+
+UBoneDamageSubsystem::UBoneDamageSubsystem()
+{
+	Generation = 0;
+}
+
+void UBoneDamageSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+#if WITH_EDITOR
+	//Editing weapon defaults changes their modifiers, rebuild on the next hit
+	PropertyChangedHandle = FCoreUObjectDelegates::OnObjectPropertyChanged.AddUObject(this, &UBoneDamageSubsystem::OnObjectPropertyChanged);
+#endif
+}
+
+void UBoneDamageSubsystem::Deinitialize()
+{
+#if WITH_EDITOR
+	FCoreUObjectDelegates::OnObjectPropertyChanged.Remove(PropertyChangedHandle);
+#endif
+
+	ResetTables();
+
+	Super::Deinitialize();
+}
+
+TSharedRef<const TArray<float>> UBoneDamageSubsystem::GetBoneDamageTable(const AWeapon* Weapon, const USkeletalMesh* Mesh)
+{
+	const TPair<FObjectKey, FObjectKey> TableKey(FObjectKey(Weapon->GetClass()), FObjectKey(Mesh));
+
+	if (const TSharedRef<const TArray<float>>* ExistingTable = Tables.Find(TableKey))
+	{
+		return *ExistingTable;
+	}
+	return Tables.Add(TableKey, BuildBoneDamageTable(Weapon, Mesh));
+}
+
+TSharedRef<const TArray<float>> UBoneDamageSubsystem::BuildBoneDamageTable(const AWeapon* Weapon, const USkeletalMesh* Mesh) const
+{
+	TArray<float> Multipliers;
+	if (Mesh)
+	{
+		const FReferenceSkeleton& RefSkeleton = Mesh->RefSkeleton;
+		Multipliers.Init(1.f, RefSkeleton.GetNum());
+
+		//Hitscan hits are only ever reported on the lag compensated bones, a modifier on any other bone never applies
+		const ULagCompensationSubsystem* LagCompensation = !Weapon->bUseProjectiles ? GetWorld()->GetSubsystem<ULagCompensationSubsystem>() : nullptr;
+
+		for (auto& BoneDamageModifier : Weapon->HitScanConfig.BoneDamageModifier)
+		{
+			const int32 BoneIndex = RefSkeleton.FindBoneIndex(BoneDamageModifier.Key);
+			if (BoneIndex != INDEX_NONE)
+			{
+				Multipliers[BoneIndex] = BoneDamageModifier.Value;
+			}
+
+			const FName& BoneName = BoneDamageModifier.Key;
+			if (LagCompensation && !LagCompensation->GetHitBones().ContainsByPredicate([&BoneName](const FLagCompensationHitBone& HitBone) { return HitBone.BoneName == BoneName; }))
+			{
+				UE_LOG(LogTemp, Warning, TEXT("%s has a damage modifier on bone %s, which isn't a lag compensated hit bone. Hitscan shots never hit it"), *Weapon->GetClass()->GetName(), *BoneName.ToString());
+			}
+		}
+	}
+	return MakeShared<TArray<float>>(MoveTemp(Multipliers));
+}
+
+void UBoneDamageSubsystem::ResetTables()
+{
+	Tables.Empty();
+	++Generation;
+}
+
+#if WITH_EDITOR
+void UBoneDamageSubsystem::OnObjectPropertyChanged(UObject* Object, FPropertyChangedEvent& PropertyChangedEvent)
+{
+	if (Object && Object->IsA<AWeapon>())
+	{
+		ResetTables();
+	}
+}
+#endif
@@ -0,0 +1,52 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/ObjectKey.h"
+#include "BoneDamageSubsystem.generated.h"
+
+class AWeapon;
+class USkeletalMesh;
+
+/**
+ * Per world cache of the bone damage tables weapons look up damage multipliers in. A table is built once for every
+ * weapon class and skeletal mesh pair and shared by all weapons of the class, it goes away with the world.
+ */
+UCLASS()
+class SURVIVALGAME_API UBoneDamageSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	UBoneDamageSubsystem();
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	/**Damage multiplier of every bone of Mesh for the class of Weapon, indexed by the mesh's bone index.
+	Built from the weapon's HitScanConfig.BoneDamageModifier the first time any weapon of the class needs it.*/
+	TSharedRef<const TArray<float>> GetBoneDamageTable(const AWeapon* Weapon, const USkeletalMesh* Mesh);
+
+	//Bumped whenever the tables are emptied, weapons drop the table they cached from an older generation
+	FORCEINLINE uint32 GetGeneration() const { return Generation; };
+
+protected:
+
+	TSharedRef<const TArray<float>> BuildBoneDamageTable(const AWeapon* Weapon, const USkeletalMesh* Mesh) const;
+
+	void ResetTables();
+
+#if WITH_EDITOR
+	void OnObjectPropertyChanged(UObject* Object, struct FPropertyChangedEvent& PropertyChangedEvent);
+
+	FDelegateHandle PropertyChangedHandle;
+#endif
+
+	//Keyed by weapon class and skeletal mesh
+	TMap<TPair<FObjectKey, FObjectKey>, TSharedRef<const TArray<float>>> Tables;
+
+	uint32 Generation;
+};
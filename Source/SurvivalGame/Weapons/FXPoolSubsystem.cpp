@@ -0,0 +1,139 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "FXPoolSubsystem.h"
+#include "Components/AudioComponent.h"
+#include "Kismet/GameplayStatics.h"
+#include "Sound/SoundBase.h"
+#include "Engine/World.h"
+#include "GameFramework/WorldSettings.h"
+
+static const ERenameFlags PooledComponentRenameFlags = REN_DontCreateRedirectors | REN_DoNotDirty | REN_NonTransactional | REN_ForceNoResetLoaders;
+
+UFXPoolSubsystem::UFXPoolSubsystem()
+{
+	MaxActivePerTemplate = 16;
+}
+
+void UFXPoolSubsystem::Deinitialize()
+{
+	Pools.Empty();
+
+	Super::Deinitialize();
+}
+
+UAudioComponent* UFXPoolSubsystem::SpawnSoundAttached(USoundBase* Sound, USceneComponent* AttachToComponent, FName AttachPointName)
+{
+	if (!Sound || !AttachToComponent)
+	{
+		return nullptr;
+	}
+
+	UWorld* World = AttachToComponent->GetWorld();
+	UFXPoolSubsystem* FXPool = World ? World->GetSubsystem<UFXPoolSubsystem>() : nullptr;
+	if (!FXPool)
+	{
+		return UGameplayStatics::SpawnSoundAttached(Sound, AttachToComponent, AttachPointName);
+	}
+
+	UObject* Outer = AttachToComponent->GetOwner() ? static_cast<UObject*>(AttachToComponent->GetOwner()) : static_cast<UObject*>(World->GetWorldSettings());
+	UAudioComponent* AC = FXPool->AcquireAudio(Sound, Outer);
+	if (AC)
+	{
+		AC->AttachToComponent(AttachToComponent, FAttachmentTransformRules::SnapToTargetNotIncludingScale, AttachPointName);
+		AC->Play();
+	}
+	return AC;
+}
+
+UAudioComponent* UFXPoolSubsystem::AcquireAudio(USoundBase* Sound, UObject* Outer)
+{
+	if (!Sound || !Outer)
+	{
+		return nullptr;
+	}
+
+	UAudioComponent* AC = Cast<UAudioComponent>(AcquireFree(Sound, Outer));
+	if (!AC)
+	{
+		FFXComponentPool& Pool = Pools.FindOrAdd(Sound);
+		if (Pool.ActiveComponents.Num() >= MaxActivePerTemplate)
+		{
+			return nullptr;
+		}
+
+		AC = NewObject<UAudioComponent>(Outer);
+		AC->bAutoActivate = false;
+		AC->bAutoDestroy = false;
+		AC->bStopWhenOwnerDestroyed = true;
+		AC->SetSound(Sound);
+		AC->OnAudioFinishedNative.AddUObject(this, &UFXPoolSubsystem::OnAudioFinished);
+		AC->RegisterComponentWithWorld(GetWorld());
+
+		Pool.ActiveComponents.Add(AC);
+	}
+	return AC;
+}
+
+USceneComponent* UFXPoolSubsystem::AcquireFree(UObject* Template, UObject* Outer)
+{
+	FFXComponentPool& Pool = Pools.FindOrAdd(Template);
+
+	//Components die with the actor they belong to
+	Pool.ActiveComponents.RemoveAllSwap([](const USceneComponent* Component) { return !IsValid(Component); });
+	Pool.FreeComponents.RemoveAllSwap([](const USceneComponent* Component) { return !IsValid(Component); });
+
+	if (Pool.FreeComponents.Num() == 0 || Pool.ActiveComponents.Num() >= MaxActivePerTemplate)
+	{
+		return nullptr;
+	}
+
+	//Prefer one that already belongs to Outer, moving a component to another actor means registering it again
+	int32 Index = Pool.FreeComponents.FindLastByPredicate([Outer](const USceneComponent* Component) { return Component->GetOuter() == Outer; });
+	if (Index == INDEX_NONE)
+	{
+		Index = Pool.FreeComponents.Num() - 1;
+	}
+
+	USceneComponent* Component = Pool.FreeComponents[Index];
+	Pool.FreeComponents.RemoveAtSwap(Index, 1, false);
+
+	if (Component->GetOuter() != Outer)
+	{
+		Component->UnregisterComponent();
+		Component->Rename(nullptr, Outer, PooledComponentRenameFlags);
+		Component->RegisterComponentWithWorld(GetWorld());
+	}
+
+	Pool.ActiveComponents.Add(Component);
+	return Component;
+}
+
+void UFXPoolSubsystem::Release(USceneComponent* Component)
+{
+	UAudioComponent* AC = Cast<UAudioComponent>(Component);
+
+	UObject* Template = AC ? static_cast<UObject*>(AC->Sound) : nullptr;
+	FFXComponentPool* Pool = Template ? Pools.Find(Template) : nullptr;
+
+	//Stopping a component below finishes it again, it's only in the active list the first time
+	if (!Pool || Pool->ActiveComponents.RemoveSwap(Component) == 0)
+	{
+		return;
+	}
+
+	if (AC->IsPlaying())
+	{
+		AC->Stop();
+	}
+
+	if (IsValid(Component))
+	{
+		Component->DetachFromComponent(FDetachmentTransformRules::KeepWorldTransform);
+		Pool->FreeComponents.Add(Component);
+	}
+}
+
+void UFXPoolSubsystem::OnAudioFinished(UAudioComponent* AC)
+{
+	Release(AC);
+}
@@ -0,0 +1,67 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "FXPoolSubsystem.generated.h"
+
+class USoundBase;
+class UAudioComponent;
+
+USTRUCT()
+struct FFXComponentPool
+{
+	GENERATED_BODY()
+
+public:
+
+	UPROPERTY()
+	TArray<USceneComponent*> FreeComponents;
+
+	//Playing right now, they come back to FreeComponents when they finish
+	UPROPERTY()
+	TArray<USceneComponent*> ActiveComponents;
+};
+
+/**
+ * Per world pool of audio components keyed by the sound they play, so weapon sounds reuse registered components
+ * instead of spawning a new one every shot. Components release themselves when they finish playing and each sound
+ * has a cap on how many can play at once, sounds past it are skipped. Particle effects use the engine's own pool
+ * through UGameplayStatics with EPSCPoolMethod::AutoRelease instead.
+ */
+UCLASS()
+class SURVIVALGAME_API UFXPoolSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	UFXPoolSubsystem();
+
+	virtual void Deinitialize() override;
+
+	/**Plays Sound attached to AttachToComponent, owned by the component's actor.
+	Returns null if the sound is at its cap. Falls back to UGameplayStatics when the world has no pool.*/
+	static UAudioComponent* SpawnSoundAttached(USoundBase* Sound, USceneComponent* AttachToComponent, FName AttachPointName = NAME_None);
+
+	//Outer is the actor the component belongs to, or the world settings for sounds that don't follow any actor
+	UAudioComponent* AcquireAudio(USoundBase* Sound, UObject* Outer);
+
+	//Components release themselves when they finish, this is for effects stopped early
+	void Release(USceneComponent* Component);
+
+protected:
+
+	//Takes a free component of Template, moves it to Outer and marks it active. Null if there is none or Template is at its cap
+	USceneComponent* AcquireFree(UObject* Template, UObject* Outer);
+
+	void OnAudioFinished(UAudioComponent* AC);
+
+	UPROPERTY()
+	TMap<UObject*, FFXComponentPool> Pools;
+
+	//Max amount of components of one template playing at once
+	UPROPERTY()
+	int32 MaxActivePerTemplate;
+};
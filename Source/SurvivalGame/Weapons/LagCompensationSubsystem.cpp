@@ -0,0 +1,283 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LagCompensationSubsystem.h"
+#include "Player/SurvivalCharacter.h"
+#include "Components/CapsuleComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "GameFramework/GameStateBase.h"
+#include "Engine/World.h"
+
+ULagCompensationSubsystem::ULagCompensationSubsystem()
+{
+	bInitialized = false;
+	LastSampleTime = -1.f;
+	SampleInterval = 1.f / 30.f;
+	MaxRewindTime = 0.5f;
+	HitTolerance = 15.f;
+	MaxShotOriginError = 250.f;
+
+	HitBones.Add(FLagCompensationHitBone(FName("head"), 14.f));
+	HitBones.Add(FLagCompensationHitBone(FName("spine_03"), 20.f));
+	HitBones.Add(FLagCompensationHitBone(FName("pelvis"), 18.f));
+	HitBones.Add(FLagCompensationHitBone(FName("upperarm_l"), 9.f));
+	HitBones.Add(FLagCompensationHitBone(FName("upperarm_r"), 9.f));
+	HitBones.Add(FLagCompensationHitBone(FName("thigh_l"), 11.f));
+	HitBones.Add(FLagCompensationHitBone(FName("thigh_r"), 11.f));
+	HitBones.Add(FLagCompensationHitBone(FName("calf_l"), 9.f));
+	HitBones.Add(FLagCompensationHitBone(FName("calf_r"), 9.f));
+	check(HitBones.Num() <= LagCompensation::MaxHitBones);
+}
+
+void ULagCompensationSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	bInitialized = true;
+}
+
+void ULagCompensationSubsystem::Deinitialize()
+{
+	bInitialized = false;
+	Histories.Empty();
+
+	Super::Deinitialize();
+}
+
+ETickableTickType ULagCompensationSubsystem::GetTickableTickType() const
+{
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+bool ULagCompensationSubsystem::IsTickable() const
+{
+	return bInitialized && Histories.Num() > 0;
+}
+
+TStatId ULagCompensationSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(ULagCompensationSubsystem, STATGROUP_Tickables);
+}
+
+float ULagCompensationSubsystem::GetShotTime(const UWorld* World)
+{
+	if (!World)
+	{
+		return 0.f;
+	}
+
+	const AGameStateBase* GameState = World->GetGameState();
+	return GameState ? GameState->GetServerWorldTimeSeconds() : World->GetTimeSeconds();
+}
+
+void ULagCompensationSubsystem::RegisterCharacter(ASurvivalCharacter* Character)
+{
+	if (!Character || Histories.Contains(Character))
+	{
+		return;
+	}
+
+	FLagCompensationHistory& History = Histories.Add(Character);
+
+	if (USkeletalMeshComponent* Mesh = Character->GetMesh())
+	{
+		//Servers don't render, so by default the pose stops updating once nobody sees the mesh and the recorded bones would freeze
+		Mesh->VisibilityBasedAnimTickOption = EVisibilityBasedAnimTickOption::AlwaysTickPoseAndRefreshBones;
+
+		for (int32 i = 0; i < HitBones.Num(); ++i)
+		{
+			History.BoneIndices[i] = Mesh->GetBoneIndex(HitBones[i].BoneName);
+		}
+	}
+
+	RecordFrame(Character, History, GetShotTime(GetWorld()));
+}
+
+void ULagCompensationSubsystem::UnregisterCharacter(ASurvivalCharacter* Character)
+{
+	Histories.Remove(Character);
+}
+
+void ULagCompensationSubsystem::Tick(float DeltaTime)
+{
+	const float Now = GetShotTime(GetWorld());
+	if (LastSampleTime >= 0.f && Now - LastSampleTime < SampleInterval)
+	{
+		return;
+	}
+	LastSampleTime = Now;
+
+	for (auto& CharacterHistory : Histories)
+	{
+		RecordFrame(CharacterHistory.Key, CharacterHistory.Value, Now);
+	}
+}
+
+void ULagCompensationSubsystem::RecordFrame(ASurvivalCharacter* Character, FLagCompensationHistory& History, const float Time) const
+{
+	History.Newest = (History.Newest + 1) % LagCompensation::NumFrames;
+	History.NumValid = FMath::Min(History.NumValid + 1, LagCompensation::NumFrames);
+
+	FLagCompensationFrame& Frame = History.Frames[History.Newest];
+	Frame.Time = Time;
+
+	const UCapsuleComponent* Capsule = Character->GetCapsuleComponent();
+	Frame.CapsuleCenter = Capsule->GetComponentLocation();
+	Frame.CapsuleHalfHeight = Capsule->GetScaledCapsuleHalfHeight();
+	Frame.CapsuleRadius = Capsule->GetScaledCapsuleRadius();
+
+	const USkeletalMeshComponent* Mesh = Character->GetMesh();
+	for (int32 i = 0; i < HitBones.Num(); ++i)
+	{
+		Frame.BoneLocations[i] = Mesh && History.BoneIndices[i] != INDEX_NONE ? Mesh->GetBoneTransform(History.BoneIndices[i]).GetLocation() : Frame.CapsuleCenter;
+	}
+}
+
+bool ULagCompensationSubsystem::RewindHistory(const FLagCompensationHistory& History, const float Time, FLagCompensationFrame& OutFrame) const
+{
+	if (History.NumValid == 0)
+	{
+		return false;
+	}
+
+	//Walk back from the newest frame until we pass Time
+	int32 NewerIndex = History.Newest;
+	for (int32 Step = 1; Step < History.NumValid; ++Step)
+	{
+		const int32 OlderIndex = (History.Newest - Step + LagCompensation::NumFrames) % LagCompensation::NumFrames;
+		const FLagCompensationFrame& Older = History.Frames[OlderIndex];
+		const FLagCompensationFrame& Newer = History.Frames[NewerIndex];
+
+		if (Older.Time <= Time)
+		{
+			const float Alpha = Newer.Time > Older.Time ? FMath::Clamp((Time - Older.Time) / (Newer.Time - Older.Time), 0.f, 1.f) : 1.f;
+
+			OutFrame.Time = Time;
+			OutFrame.CapsuleCenter = FMath::Lerp(Older.CapsuleCenter, Newer.CapsuleCenter, Alpha);
+			OutFrame.CapsuleHalfHeight = FMath::Lerp(Older.CapsuleHalfHeight, Newer.CapsuleHalfHeight, Alpha);
+			OutFrame.CapsuleRadius = FMath::Lerp(Older.CapsuleRadius, Newer.CapsuleRadius, Alpha);
+			for (int32 i = 0; i < HitBones.Num(); ++i)
+			{
+				OutFrame.BoneLocations[i] = FMath::Lerp(Older.BoneLocations[i], Newer.BoneLocations[i], Alpha);
+			}
+			return true;
+		}
+		NewerIndex = OlderIndex;
+	}
+
+	//Time is older than the oldest frame, or there is only one
+	OutFrame = History.Frames[NewerIndex];
+	return true;
+}
+
+bool ULagCompensationSubsystem::CheckShot(const ASurvivalCharacter* Shooter, const FVector& TraceStart, const float ShotTime, FString& OutRejectReason) const
+{
+	if (!Shooter)
+	{
+		OutRejectReason = TEXT("missing shooter");
+		return false;
+	}
+
+	const float Now = GetShotTime(GetWorld());
+	if (Now - ShotTime > MaxRewindTime)
+	{
+		OutRejectReason = FString::Printf(TEXT("shot is %.3fs old, more than the %.3fs we rewind"), Now - ShotTime, MaxRewindTime);
+		return false;
+	}
+
+	//Where the shooter was when they fired, the server has already moved them on by the time the shot arrives
+	FVector ShooterLocation = Shooter->GetActorLocation();
+	FLagCompensationFrame ShooterFrame;
+	if (const FLagCompensationHistory* ShooterHistory = Histories.Find(const_cast<ASurvivalCharacter*>(Shooter)))
+	{
+		if (RewindHistory(*ShooterHistory, ShotTime, ShooterFrame))
+		{
+			ShooterLocation = ShooterFrame.CapsuleCenter;
+		}
+	}
+
+	const float OriginError = FVector::Dist(TraceStart, ShooterLocation);
+	if (OriginError > MaxShotOriginError)
+	{
+		OutRejectReason = FString::Printf(TEXT("shot starts %.0f units away from the shooter"), OriginError);
+		return false;
+	}
+	return true;
+}
+
+bool ULagCompensationSubsystem::TraceFrame(const FLagCompensationHistory& History, const FLagCompensationFrame& Frame, const FVector& TraceStart, const FVector& TraceEnd, int32& OutHitBone, FVector& OutHitLocation, float& OutMissDistance) const
+{
+	OutHitBone = INDEX_NONE;
+
+	//Capsule first, it covers every bone
+	const float CapsuleSegmentHalfLength = FMath::Max(Frame.CapsuleHalfHeight - Frame.CapsuleRadius, 0.f);
+	const FVector CapsuleTop = Frame.CapsuleCenter + FVector(0.f, 0.f, CapsuleSegmentHalfLength);
+	const FVector CapsuleBottom = Frame.CapsuleCenter - FVector(0.f, 0.f, CapsuleSegmentHalfLength);
+
+	FVector ClosestOnShot;
+	FVector ClosestOnCapsule;
+	FMath::SegmentDistToSegmentSafe(TraceStart, TraceEnd, CapsuleBottom, CapsuleTop, ClosestOnShot, ClosestOnCapsule);
+
+	OutMissDistance = FVector::Dist(ClosestOnShot, ClosestOnCapsule) - Frame.CapsuleRadius;
+	if (OutMissDistance > HitTolerance)
+	{
+		return false;
+	}
+	OutHitLocation = ClosestOnShot;
+
+	float ClosestBoneDistance = MAX_flt;
+	for (int32 i = 0; i < HitBones.Num(); ++i)
+	{
+		if (History.BoneIndices[i] != INDEX_NONE && FMath::PointDistToSegment(Frame.BoneLocations[i], TraceStart, TraceEnd) <= HitBones[i].Radius + HitTolerance)
+		{
+			const float BoneDistance = FVector::DistSquared(TraceStart, Frame.BoneLocations[i]);
+			if (BoneDistance < ClosestBoneDistance)
+			{
+				ClosestBoneDistance = BoneDistance;
+				OutHitBone = i;
+				OutHitLocation = FMath::ClosestPointOnSegment(Frame.BoneLocations[i], TraceStart, TraceEnd);
+			}
+		}
+	}
+	return true;
+}
+
+bool ULagCompensationSubsystem::TraceShot(const ASurvivalCharacter* Shooter, const FVector& TraceStart, const FVector& TraceEnd, const float ShotTime, ASurvivalCharacter*& OutTarget, FName& OutBoneName, int32& OutBoneIndex, FVector& OutHitLocation, FString& OutRejectReason) const
+{
+	OutTarget = nullptr;
+	OutBoneName = NAME_None;
+	OutBoneIndex = INDEX_NONE;
+
+	if (!CheckShot(Shooter, TraceStart, ShotTime, OutRejectReason))
+	{
+		return false;
+	}
+
+	const float RewindTime = FMath::Min(ShotTime, GetShotTime(GetWorld()));
+	float ClosestHitDistance = MAX_flt;
+
+	for (const auto& CharacterHistory : Histories)
+	{
+		if (CharacterHistory.Key == Shooter)
+		{
+			continue;
+		}
+
+		FLagCompensationFrame Frame;
+		int32 HitBone;
+		FVector HitLocation;
+		float MissDistance;
+		if (RewindHistory(CharacterHistory.Value, RewindTime, Frame) && TraceFrame(CharacterHistory.Value, Frame, TraceStart, TraceEnd, HitBone, HitLocation, MissDistance))
+		{
+			const float HitDistance = FVector::DistSquared(TraceStart, HitLocation);
+			if (HitDistance < ClosestHitDistance)
+			{
+				ClosestHitDistance = HitDistance;
+				OutTarget = CharacterHistory.Key;
+				OutBoneName = HitBone != INDEX_NONE ? HitBones[HitBone].BoneName : NAME_None;
+				OutBoneIndex = HitBone != INDEX_NONE ? CharacterHistory.Value.BoneIndices[HitBone] : INDEX_NONE;
+				OutHitLocation = HitLocation;
+			}
+		}
+	}
+	return true;
+}
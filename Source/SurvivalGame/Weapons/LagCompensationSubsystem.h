@@ -0,0 +1,129 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "LagCompensationSubsystem.generated.h"
+
+class ASurvivalCharacter;
+
+namespace LagCompensation
+{
+	//Frames kept per character, at the default sample rate a little over a second of history
+	static constexpr int32 NumFrames = 32;
+	//Bones buffered per frame on top of the capsule
+	static constexpr int32 MaxHitBones = 9;
+}
+
+//A bone that gets its own hit sphere in the buffered poses
+struct FLagCompensationHitBone
+{
+	FLagCompensationHitBone() : Radius(0.f) {};
+	FLagCompensationHitBone(const FName& InBoneName, const float InRadius) : BoneName(InBoneName), Radius(InRadius) {};
+
+	FName BoneName;
+	float Radius;
+};
+
+//Where a character's hitboxes were at one point in time
+struct FLagCompensationFrame
+{
+	float Time;
+	FVector CapsuleCenter;
+	float CapsuleHalfHeight;
+	float CapsuleRadius;
+	FVector BoneLocations[LagCompensation::MaxHitBones];
+};
+
+//Fixed size ring of a character's recent frames, nothing is allocated after registration
+struct FLagCompensationHistory
+{
+	FLagCompensationHistory() : Newest(INDEX_NONE), NumValid(0)
+	{
+		for (int32& BoneIndex : BoneIndices)
+		{
+			BoneIndex = INDEX_NONE;
+		}
+	};
+
+	FLagCompensationFrame Frames[LagCompensation::NumFrames];
+	int32 Newest;
+	int32 NumValid;
+
+	//Mesh bone index of every hit bone, INDEX_NONE if the mesh doesn't have it
+	int32 BoneIndices[LagCompensation::MaxHitBones];
+};
+
+/**
+ * Records the hitboxes of every character on the server so shots can be checked against where
+ * the target was on the shooter's screen. Shots are re-traced against the buffered capsule and a
+ * few bone spheres instead of the physics scene, hits that don't hold up are rejected and logged.
+ */
+UCLASS()
+class SURVIVALGAME_API ULagCompensationSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+
+	ULagCompensationSubsystem();
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+
+	//Server side, characters are recorded from registration until they unregister
+	void RegisterCharacter(ASurvivalCharacter* Character);
+	void UnregisterCharacter(ASurvivalCharacter* Character);
+
+	/**Rewinds every character but the shooter to ShotTime and finds the closest one the shot passes through.
+	OutTarget is null if the shot hits nobody, OutBoneIndex is the hit bone's index in the target's mesh.
+	Returns false if the shot itself is rejected, OutRejectReason says why.*/
+	bool TraceShot(const ASurvivalCharacter* Shooter, const FVector& TraceStart, const FVector& TraceEnd, const float ShotTime, ASurvivalCharacter*& OutTarget, FName& OutBoneName, int32& OutBoneIndex, FVector& OutHitLocation, FString& OutRejectReason) const;
+
+	//Checks the shot's age and where it starts
+	bool CheckShot(const ASurvivalCharacter* Shooter, const FVector& TraceStart, const float ShotTime, FString& OutRejectReason) const;
+
+	//Bones with a buffered hit sphere, shots can only ever report one of these or a capsule hit
+	FORCEINLINE const TArray<FLagCompensationHitBone>& GetHitBones() const { return HitBones; };
+
+	//The clock shots are timestamped with, the server's world time so clients and server agree
+	static float GetShotTime(const UWorld* World);
+
+protected:
+
+	void RecordFrame(ASurvivalCharacter* Character, FLagCompensationHistory& History, const float Time) const;
+
+	//Traces the shot against a rewound frame, OutHitBone indexes HitBones or is INDEX_NONE for a capsule only hit. OutMissDistance is how far it passes outside the capsule
+	bool TraceFrame(const FLagCompensationHistory& History, const FLagCompensationFrame& Frame, const FVector& TraceStart, const FVector& TraceEnd, int32& OutHitBone, FVector& OutHitLocation, float& OutMissDistance) const;
+
+	//Interpolates the history at Time, false if there is nothing recorded
+	bool RewindHistory(const FLagCompensationHistory& History, const float Time, FLagCompensationFrame& OutFrame) const;
+
+	bool bInitialized;
+
+	float LastSampleTime;
+
+	//Seconds between recorded frames
+	float SampleInterval;
+
+	//How far back shots are rewound at most, older shots are rejected
+	float MaxRewindTime;
+
+	//Slack for interpolation and the client's view of the target, added to every hitbox
+	float HitTolerance;
+
+	//How far the shot may start from the shooter
+	float MaxShotOriginError;
+
+	TArray<FLagCompensationHitBone> HitBones;
+
+	//Characters always unregister before they are destroyed
+	TMap<ASurvivalCharacter*, FLagCompensationHistory> Histories;
+};
@@ -0,0 +1,376 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "ProjectileSubsystem.h"
+#include "SurvivalGame/SurvivalGame.h"
+
+#include "Weapons/Weapon.h"
+#include "Weapons/LagCompensationSubsystem.h"
+#include "Player/SurvivalCharacter.h"
+#include "Items/ThrowableItem.h"
+
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Kismet/GameplayStatics.h"
+#include "Engine/SkeletalMesh.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerState.h"
+
+UProjectileSubsystem::UProjectileSubsystem()
+{
+	bInitialized = false;
+	FixedStep = 1.f / 60.f;
+	MaxStepsPerTick = 8;
+	MaxCatchUpTime = 0.5f;
+	MaxBacklogTime = 0.5f;
+	StepAccumulator = 0.f;
+	NumDrawnInstances = 0;
+	VisualsActor = nullptr;
+}
+
+void UProjectileSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	bInitialized = true;
+}
+
+void UProjectileSubsystem::Deinitialize()
+{
+	bInitialized = false;
+
+	Positions.Empty();
+	Velocities.Empty();
+	Ages.Empty();
+	BouncesLeft.Empty();
+	RestingFlags.Empty();
+	Configs.Empty();
+	Causers.Empty();
+
+	MeshInstances.Empty();
+	VisualsActor = nullptr;
+
+	Super::Deinitialize();
+}
+
+ETickableTickType UProjectileSubsystem::GetTickableTickType() const
+{
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+bool UProjectileSubsystem::IsTickable() const
+{
+	return bInitialized && (Positions.Num() > 0 || NumDrawnInstances > 0);
+}
+
+TStatId UProjectileSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UProjectileSubsystem, STATGROUP_Tickables);
+}
+
+void UProjectileSubsystem::Tick(float DeltaTime)
+{
+	//Steps past MaxStepsPerTick are left in the accumulator for the next frames, so a hitch slows projectiles down for a moment instead of losing time
+	StepAccumulator = FMath::Min(StepAccumulator + DeltaTime, MaxBacklogTime);
+
+	int32 NumSteps = 0;
+	while (StepAccumulator >= FixedStep && NumSteps < MaxStepsPerTick)
+	{
+		//Backwards so finished projectiles can be swapped out as we go
+		for (int32 Index = Positions.Num() - 1; Index >= 0; --Index)
+		{
+			if (!StepProjectile(Index, FixedStep))
+			{
+				RemoveProjectile(Index);
+			}
+		}
+
+		StepAccumulator -= FixedStep;
+		++NumSteps;
+	}
+
+	UpdateVisuals();
+}
+
+bool UProjectileSubsystem::LaunchProjectile(const FProjectileSeed& Seed)
+{
+	const FProjectileConfig* Config = FindProjectileConfig(Seed.ConfigSource);
+	if (!bInitialized || !Config)
+	{
+		return false;
+	}
+
+	if (Positions.Num() == 0)
+	{
+		StepAccumulator = 0.f;
+	}
+
+	const int32 Index = Positions.Add(Seed.Origin);
+	Velocities.Add(Seed.Direction.GetSafeNormal() * Config->InitialSpeed);
+	Ages.Add(0.f);
+	BouncesLeft.Add((uint8)FMath::Clamp(Config->MaxBounces, 0, (int32)MAX_uint8));
+	RestingFlags.Add(false);
+	Configs.Add(Config);
+	Causers.Add(Seed.Causer);
+
+	//Seeds reach clients late, fly them forward to where the launching machine has them by now
+	const float Lateness = FMath::Clamp(ULagCompensationSubsystem::GetShotTime(GetWorld()) - Seed.LaunchTime, 0.f, GetMaxCatchUpTime(Seed));
+	for (int32 Step = FMath::FloorToInt(Lateness / FixedStep); Step > 0; --Step)
+	{
+		if (!StepProjectile(Index, FixedStep))
+		{
+			RemoveProjectile(Index);
+			break;
+		}
+	}
+
+	return true;
+}
+
+float UProjectileSubsystem::GetMaxCatchUpTime(const FProjectileSeed& Seed) const
+{
+	if (GetWorld()->GetNetMode() == NM_Client)
+	{
+		return MaxCatchUpTime;
+	}
+
+	//LaunchTime comes from the shooting client, so on the server it can't buy more travel than the shot could have taken to arrive
+	const APawn* Shooter = Cast<APawn>(Seed.Causer);
+	if (!Shooter && Seed.Causer)
+	{
+		Shooter = Seed.Causer->GetInstigator();
+	}
+
+	const APlayerState* ShooterState = Shooter ? Shooter->GetPlayerState() : nullptr;
+	if (!ShooterState || Shooter->IsLocallyControlled())
+	{
+		return 0.f;
+	}
+	return FMath::Min(MaxCatchUpTime, ShooterState->ExactPing * 0.0005f);
+}
+
+const FProjectileConfig* UProjectileSubsystem::FindProjectileConfig(const UClass* ConfigSource)
+{
+	if (!ConfigSource)
+	{
+		return nullptr;
+	}
+
+	if (ConfigSource->IsChildOf(AWeapon::StaticClass()))
+	{
+		return ConfigSource->GetDefaultObject<AWeapon>()->GetProjectileConfig();
+	}
+
+	if (ConfigSource->IsChildOf(UThrowableItem::StaticClass()))
+	{
+		const UThrowableItem* Throwable = ConfigSource->GetDefaultObject<UThrowableItem>();
+		return Throwable->bSimulateAsProjectile ? &Throwable->ProjectileConfig : nullptr;
+	}
+
+	return nullptr;
+}
+
+bool UProjectileSubsystem::StepProjectile(const int32 Index, const float DeltaTime)
+{
+	const FProjectileConfig& Config = *Configs[Index];
+
+	Ages[Index] += DeltaTime;
+	if (Ages[Index] >= Config.LifeSpan)
+	{
+		DetonateProjectile(Index, nullptr);
+		return false;
+	}
+
+	if (RestingFlags[Index])
+	{
+		return true;
+	}
+
+	UWorld* World = GetWorld();
+
+	FVector& Velocity = Velocities[Index];
+	Velocity.Z += World->GetGravityZ() * Config.GravityScale * DeltaTime;
+	if (Config.Drag > 0.f)
+	{
+		Velocity *= FMath::Max(0.f, 1.f - Config.Drag * DeltaTime);
+	}
+
+	const FVector Start = Positions[Index];
+	const FVector End = Start + Velocity * DeltaTime;
+
+	AActor* Causer = Causers[Index].Get();
+	FCollisionQueryParams QParams(SCENE_QUERY_STAT(ProjectileSweep), true, Causer);
+	if (Causer && Causer->GetInstigator())
+	{
+		QParams.AddIgnoredActor(Causer->GetInstigator());
+	}
+
+	FHitResult Hit;
+	const bool bHit = Config.Radius > 0.f
+		? World->SweepSingleByChannel(Hit, Start, End, FQuat::Identity, COLLISION_WEAPON, FCollisionShape::MakeSphere(Config.Radius), QParams)
+		: World->LineTraceSingleByChannel(Hit, Start, End, COLLISION_WEAPON, QParams);
+
+	if (!bHit)
+	{
+		Positions[Index] = End;
+		return true;
+	}
+
+	Positions[Index] = Hit.Location;
+
+	const bool bHitPawn = Cast<APawn>(Hit.GetActor()) != nullptr;
+	if (!bHitPawn && BouncesLeft[Index] > 0)
+	{
+		--BouncesLeft[Index];
+
+		const FVector IntoSurface = Hit.ImpactNormal * (Velocity | Hit.ImpactNormal);
+		const FVector AlongSurface = Velocity - IntoSurface;
+		Velocity = AlongSurface * (1.f - Config.Friction) - IntoSurface * Config.Bounciness;
+
+		//Lift it off the surface so the next sweep doesn't start inside it
+		Positions[Index] += Hit.ImpactNormal * 0.1f;
+
+		if (!Config.bDetonateOnImpact && Velocity.SizeSquared() < FMath::Square(20.f))
+		{
+			RestingFlags[Index] = true;
+			Velocity = FVector::ZeroVector;
+		}
+		return true;
+	}
+
+	if (bHitPawn || Config.bDetonateOnImpact)
+	{
+		DetonateProjectile(Index, &Hit);
+		return false;
+	}
+
+	RestingFlags[Index] = true;
+	Velocity = FVector::ZeroVector;
+	return true;
+}
+
+void UProjectileSubsystem::DetonateProjectile(const int32 Index, const FHitResult* Hit)
+{
+	const FProjectileConfig& Config = *Configs[Index];
+	UWorld* World = GetWorld();
+
+	const FVector Location = Hit ? FVector(Hit->ImpactPoint) : Positions[Index];
+
+	if (Config.ImpactFX && !World->IsNetMode(NM_DedicatedServer))
+	{
+		UGameplayStatics::SpawnEmitterAtLocation(World, Config.ImpactFX, Location, Hit ? Hit->ImpactNormal.Rotation() : FRotator::ZeroRotator, FVector(1.f), true, EPSCPoolMethod::AutoRelease);
+	}
+
+	//Clients only simulate for the looks, the server's copy deals the damage
+	if (World->IsNetMode(NM_Client) || Config.Damage <= 0.f)
+	{
+		return;
+	}
+
+	AActor* Causer = Causers[Index].Get();
+	APawn* InstigatorPawn = Causer ? Causer->GetInstigator() : nullptr;
+	AController* InstigatorController = InstigatorPawn ? InstigatorPawn->GetController() : nullptr;
+
+	if (Config.ExplosionRadius > 0.f)
+	{
+		UGameplayStatics::ApplyRadialDamage(World, Config.Damage, Location, Config.ExplosionRadius, Config.DamageType, TArray<AActor*>(), Causer, InstigatorController);
+	}
+	else if (Hit && Hit->GetActor())
+	{
+		float Damage = Config.Damage;
+
+		AWeapon* Weapon = Cast<AWeapon>(Causer);
+		ASurvivalCharacter* HitChar = Cast<ASurvivalCharacter>(Hit->GetActor());
+		if (Weapon && HitChar)
+		{
+			const USkeletalMesh* Mesh = HitChar->GetMesh()->SkeletalMesh;
+			Damage *= Weapon->GetBoneDamageMultiplier(Mesh, Mesh ? Mesh->RefSkeleton.FindBoneIndex(Hit->BoneName) : INDEX_NONE);
+		}
+
+		UGameplayStatics::ApplyPointDamage(Hit->GetActor(), Damage, Velocities[Index].GetSafeNormal(), *Hit, InstigatorController, Causer, Config.DamageType);
+	}
+}
+
+void UProjectileSubsystem::RemoveProjectile(const int32 Index)
+{
+	Positions.RemoveAtSwap(Index, 1, false);
+	Velocities.RemoveAtSwap(Index, 1, false);
+	Ages.RemoveAtSwap(Index, 1, false);
+	BouncesLeft.RemoveAtSwap(Index, 1, false);
+	RestingFlags.RemoveAtSwap(Index, 1, false);
+	Configs.RemoveAtSwap(Index, 1, false);
+	Causers.RemoveAtSwap(Index, 1, false);
+}
+
+void UProjectileSubsystem::UpdateVisuals()
+{
+	UWorld* World = GetWorld();
+	if (World->IsNetMode(NM_DedicatedServer))
+	{
+		return;
+	}
+
+	TMap<UInstancedStaticMeshComponent*, int32, TInlineSetAllocator<4>> NumUsedInstances;
+
+	for (int32 Index = 0; Index < Positions.Num(); ++Index)
+	{
+		UStaticMesh* Mesh = Configs[Index]->Mesh;
+		if (!Mesh)
+		{
+			continue;
+		}
+
+		UInstancedStaticMeshComponent*& Instances = MeshInstances.FindOrAdd(Mesh);
+		if (!Instances)
+		{
+			if (!VisualsActor)
+			{
+				FActorSpawnParameters SpawnParams;
+				SpawnParams.ObjectFlags |= RF_Transient;
+				VisualsActor = World->SpawnActor<AActor>(AActor::StaticClass(), FTransform::Identity, SpawnParams);
+				if (!VisualsActor)
+				{
+					return;
+				}
+			}
+
+			Instances = NewObject<UInstancedStaticMeshComponent>(VisualsActor);
+			Instances->SetStaticMesh(Mesh);
+			Instances->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+			Instances->RegisterComponent();
+			VisualsActor->AddInstanceComponent(Instances);
+		}
+
+		const FVector& Velocity = Velocities[Index];
+		const FTransform Transform(Velocity.IsNearlyZero() ? FRotator::ZeroRotator : Velocity.Rotation(), Positions[Index]);
+
+		int32& NumUsed = NumUsedInstances.FindOrAdd(Instances);
+		if (NumUsed < Instances->GetInstanceCount())
+		{
+			Instances->UpdateInstanceTransform(NumUsed, Transform, true, false, true);
+		}
+		else
+		{
+			Instances->AddInstanceWorldSpace(Transform);
+		}
+		++NumUsed;
+	}
+
+	NumDrawnInstances = 0;
+	for (auto& MeshInstance : MeshInstances)
+	{
+		UInstancedStaticMeshComponent* Instances = MeshInstance.Value;
+		if (!Instances)
+		{
+			continue;
+		}
+
+		const int32 NumUsed = NumUsedInstances.FindRef(Instances);
+		while (Instances->GetInstanceCount() > NumUsed)
+		{
+			Instances->RemoveInstance(Instances->GetInstanceCount() - 1);
+		}
+
+		Instances->MarkRenderStateDirty();
+		NumDrawnInstances += NumUsed;
+	}
+}
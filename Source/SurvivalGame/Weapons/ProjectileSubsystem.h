@@ -0,0 +1,198 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "Engine/NetSerialization.h"
+#include "ProjectileSubsystem.generated.h"
+
+class UInstancedStaticMeshComponent;
+
+//How a simulated projectile flies and what it does when it stops
+USTRUCT(BlueprintType)
+struct FProjectileConfig
+{
+	GENERATED_USTRUCT_BODY()
+
+	FProjectileConfig()
+	{
+		InitialSpeed = 20000.f;
+		GravityScale = 1.f;
+		Drag = 0.f;
+		Radius = 0.f;
+		MaxBounces = 0;
+		Bounciness = 0.3f;
+		Friction = 0.2f;
+		bDetonateOnImpact = true;
+		LifeSpan = 3.f;
+		Damage = 25.f;
+		ExplosionRadius = 0.f;
+		DamageType = UDamageType::StaticClass();
+		Mesh = nullptr;
+		ImpactFX = nullptr;
+	}
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Projectile")
+	float InitialSpeed;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Projectile")
+	float GravityScale;
+
+	//Fraction of its velocity the projectile loses every second
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Projectile", meta = (ClampMin = 0.0))
+	float Drag;
+
+	//Radius of the sweep, 0 traces a line
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Projectile", meta = (ClampMin = 0.0))
+	float Radius;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Projectile", meta = (ClampMin = 0, ClampMax = 255))
+	int32 MaxBounces;
+
+	//How much of the velocity into the surface is kept on a bounce
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Projectile", meta = (ClampMin = 0.0, ClampMax = 1.0))
+	float Bounciness;
+
+	//How much of the velocity along the surface is lost on a bounce
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Projectile", meta = (ClampMin = 0.0, ClampMax = 1.0))
+	float Friction;
+
+	//Detonate when the projectile runs out of bounces, otherwise it comes to rest and detonates when its life span ends
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Projectile")
+	bool bDetonateOnImpact;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Projectile")
+	float LifeSpan;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Damage")
+	float Damage;
+
+	//Damage is dealt to everything in this radius when the projectile detonates, 0 only damages what it hits
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Damage")
+	float ExplosionRadius;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Damage")
+	TSubclassOf<class UDamageType> DamageType;
+
+	//Drawn instanced, one draw call per mesh no matter how many are in flight
+	UPROPERTY(EditDefaultsOnly, Category = "Effects")
+	class UStaticMesh* Mesh;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Effects")
+	class UParticleSystem* ImpactFX;
+};
+
+//Everything needed to launch the same projectile on another machine
+USTRUCT()
+struct FProjectileSeed
+{
+	GENERATED_USTRUCT_BODY()
+
+	FProjectileSeed()
+	{
+		LaunchTime = 0.f;
+		ConfigSource = nullptr;
+		Causer = nullptr;
+	}
+
+	UPROPERTY()
+	FVector_NetQuantize Origin;
+
+	UPROPERTY()
+	FVector_NetQuantizeNormal Direction;
+
+	//Server clock time the projectile was launched, late seeds are simulated forward to catch up
+	UPROPERTY()
+	float LaunchTime;
+
+	//Weapon or throwable item class the projectile config comes from
+	UPROPERTY()
+	UClass* ConfigSource;
+
+	//The weapon or character that launched it, ignored by its sweeps along with its instigator
+	UPROPERTY()
+	AActor* Causer;
+};
+
+/**
+ * Simulates bullets and throwables without an actor per round. Every projectile in flight is a slot in a set of
+ * parallel arrays, all of them are stepped at a fixed rate and swept against the world each step. Only the launch
+ * seed replicates, every machine simulates the flight itself and only the server deals damage.
+ */
+UCLASS()
+class SURVIVALGAME_API UProjectileSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+
+	UProjectileSubsystem();
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+
+	//Adds a projectile, false if the seed has no config to fly with
+	bool LaunchProjectile(const FProjectileSeed& Seed);
+
+	//The config a weapon or throwable item class launches, null if it doesn't use simulated projectiles
+	static const FProjectileConfig* FindProjectileConfig(const UClass* ConfigSource);
+
+	int32 GetNumProjectiles() const { return Positions.Num(); }
+
+protected:
+
+	//Advances one projectile by a step, false once it is done and should be removed
+	bool StepProjectile(const int32 Index, const float DeltaTime);
+
+	//Damage and effects for the end of a projectile's flight
+	void DetonateProjectile(const int32 Index, const FHitResult* Hit);
+
+	void RemoveProjectile(const int32 Index);
+
+	void UpdateVisuals();
+
+	bool bInitialized;
+
+	//Seconds per simulation step
+	float FixedStep;
+
+	//Steps run in one frame at most, time left over is caught up over the next frames
+	int32 MaxStepsPerTick;
+
+	//Longest a late seed is simulated forward when it arrives
+	float MaxCatchUpTime;
+
+	//MaxCatchUpTime on clients, the shooter's measured one way latency on the server
+	float GetMaxCatchUpTime(const FProjectileSeed& Seed) const;
+
+	//Most simulation time carried over between frames, only a hitch longer than this loses time
+	float MaxBacklogTime;
+
+	//Simulation time not stepped yet
+	float StepAccumulator;
+
+	//Instances drawn last frame, kept ticking until they are cleared
+	int32 NumDrawnInstances;
+
+	//The projectiles in flight, one slot per projectile across every array
+	TArray<FVector> Positions;
+	TArray<FVector> Velocities;
+	TArray<float> Ages;
+	TArray<uint8> BouncesLeft;
+	TArray<bool> RestingFlags;
+	TArray<const FProjectileConfig*> Configs;
+	TArray<TWeakObjectPtr<AActor>> Causers;
+
+	UPROPERTY(Transient)
+	AActor* VisualsActor;
+
+	UPROPERTY(Transient)
+	TMap<class UStaticMesh*, UInstancedStaticMeshComponent*> MeshInstances;
+};
@@ -20,8 +20,14 @@
 #include "Items/EquippableItem.h"
 #include "Items/AmmoItem.h"
 
-#include "DrawDebugHelpers.h"
+#include "Weapons/LagCompensationSubsystem.h"
+#include "Weapons/WeaponFireSubsystem.h"
+#include "Weapons/FXPoolSubsystem.h"
+#include "Weapons/BoneDamageSubsystem.h"
 
+#include "DrawDebugHelpers.h"
+#include "Engine/SkeletalMesh.h"
+#include "Engine/World.h"
 
 AWeapon::AWeapon()
 {
@@ -51,6 +57,20 @@ AWeapon::AWeapon()
 	RecoilSpeedReset = 5.f;
 	RecoilSpeed = 10.f;
 
+	ShotBatchInterval = 0.1f;
+	NextShotBatchSequence = 0;
+	LastShotBatchSequence = 0;
+	bReceivedShotBatch = false;
+	FireRateTolerance = 0.1f;
+	NextAllowedShotTime = 0.f;
+
+	bUseProjectiles = false;
+
+	CachedBoneDamageTableGeneration = 0;
+
+	CachedReserveAmmo = 0;
+	bReserveAmmoDirty = true;
+
 	PrimaryActorTick.bCanEverTick = true;
 	PrimaryActorTick.TickGroup = TG_PrePhysics;
 	bReplicates = true;
@@ -82,6 +102,9 @@ void AWeapon::BeginPlay()
 	{
 		PawnOwner = Cast<ASurvivalCharacter>(GetOwner());
 	}
+
+	//The server sets PawnOwner above without going through SetPawnOwner, clients may already have it replicated
+	BindAmmoInventory();
 }
 
 void AWeapon::Destroyed()
@@ -89,6 +112,11 @@ void AWeapon::Destroyed()
 	Super::Destroyed();
 
 	StopSimulatingWeaponFire();
+
+	if (UInventoryComponent* Inventory = AmmoInventory.Get())
+	{
+		Inventory->OnClassChanged.Remove(AmmoInventoryChangedHandle);
+	}
 }
 
 void AWeapon::UseClipAmmo()
@@ -105,14 +133,41 @@ void AWeapon::ConsumeAmmo(const int32 Amount)
 	{
 		if (UInventoryComponent* Inventory = PawnOwner->PlayerInventoryComponent)
 		{
-			if (UItem* AmmoItem = Inventory->FindItemByClass(WeaponConfig.AmmoClass))
-			{
-				Inventory->ConsumeItem(AmmoItem, Amount);
-			}
+			Inventory->ConsumeItemsByClass(WeaponConfig.AmmoClass, Amount);
 		}
 	}
 }
 
+void AWeapon::BindAmmoInventory()
+{
+	UInventoryComponent* Inventory = PawnOwner ? PawnOwner->PlayerInventoryComponent : nullptr;
+	if (AmmoInventory.Get() == Inventory)
+	{
+		return;
+	}
+
+	if (UInventoryComponent* OldInventory = AmmoInventory.Get())
+	{
+		OldInventory->OnClassChanged.Remove(AmmoInventoryChangedHandle);
+	}
+	AmmoInventoryChangedHandle.Reset();
+
+	AmmoInventory = Inventory;
+	if (Inventory)
+	{
+		AmmoInventoryChangedHandle = Inventory->OnClassChanged.AddUObject(this, &AWeapon::OnInventoryClassChanged);
+	}
+	bReserveAmmoDirty = true;
+}
+
+void AWeapon::OnInventoryClassChanged(UClass* ItemClass)
+{
+	if (ItemClass == WeaponConfig.AmmoClass)
+	{
+		bReserveAmmoDirty = true;
+	}
+}
+
 void AWeapon::ReturnAmmoToInventory()
 {
 	if (HasAuthority())
@@ -137,6 +192,12 @@ void AWeapon::OnEquip()
 
 	OnEquipFinished();
 
+	//Players share a mesh, build our class's bone damage table for it now rather than on the first hit
+	if (HasAuthority() && PawnOwner && PawnOwner->GetMesh())
+	{
+		GetBoneDamageTable(PawnOwner->GetMesh()->SkeletalMesh);
+	}
+
 	if (PawnOwner && PawnOwner->IsLocallyControlled())
 	{
 		PlayWeaponSound(EquipSound);
@@ -211,6 +272,12 @@ void AWeapon::StartFire()
 
 void AWeapon::StopFire()
 {
+	//Get the last shots out before the server hears that we stopped
+	if (GetLocalRole() < ROLE_Authority && PawnOwner && PawnOwner->IsLocallyControlled())
+	{
+		FlushShotBatch();
+	}
+
 	if (GetLocalRole() > ROLE_Authority && PawnOwner && PawnOwner->IsLocallyControlled())
 	{
 		ServerStopFire();
@@ -227,6 +294,8 @@ void AWeapon::StartReloadWep(bool bFromReplication /* = False */)
 {
 	if (!bFromReplication && GetLocalRole() < ROLE_Authority)
 	{
+		//The server has to spend the clip ammo of every shot we fired before it reloads
+		FlushShotBatch();
 		ServerStartReload();
 	}
 
@@ -266,6 +335,15 @@ void AWeapon::StopReload()
 
 void AWeapon::ReloadWeapon()
 {
+#if DO_CHECK
+	//Reloading moves real ammo out of the inventory, so the cached reserve has to agree with it
+	if (HasAuthority() && PawnOwner && PawnOwner->PlayerInventoryComponent)
+	{
+		ensureMsgf(GetCurrentAmmo() == PawnOwner->PlayerInventoryComponent->GetItemQuantityByClass(WeaponConfig.AmmoClass),
+			TEXT("%s reserve ammo cache is out of date: %d cached, %d in the inventory"), *GetName(), GetCurrentAmmo(), PawnOwner->PlayerInventoryComponent->GetItemQuantityByClass(WeaponConfig.AmmoClass));
+	}
+#endif
+
 	const int32 ClipDelta = FMath::Min(WeaponConfig.AmmoPerClip - CurrentAmmoInClip, GetCurrentAmmo());
 
 	if (ClipDelta > 0)
@@ -302,17 +380,20 @@ EWeaponState AWeapon::GetCurrentState() const
 
 int32 AWeapon::GetCurrentAmmo() const
 {
-	if (PawnOwner)
+	//Not bound to the owner's inventory yet, count it directly rather than trust the cache
+	const UInventoryComponent* OwnerInventory = PawnOwner ? PawnOwner->PlayerInventoryComponent : nullptr;
+	if (AmmoInventory.Get() != OwnerInventory)
 	{
-		if (UInventoryComponent* Inventory = PawnOwner->PlayerInventoryComponent)
-		{
-			if (UItem* Ammo = Inventory->FindItemByClass(WeaponConfig.AmmoClass))
-			{
-				return Ammo->GetQuantity();
-			}
-		}
+		return OwnerInventory ? OwnerInventory->GetItemQuantityByClass(WeaponConfig.AmmoClass) : 0;
+	}
+
+	if (bReserveAmmoDirty)
+	{
+		const UInventoryComponent* Inventory = AmmoInventory.Get();
+		CachedReserveAmmo = Inventory ? Inventory->GetItemQuantityByClass(WeaponConfig.AmmoClass) : 0;
+		bReserveAmmoDirty = false;
 	}
-	return 0;
+	return CachedReserveAmmo;
 }
 
 int32 AWeapon::GetCurrentAmmoInClip() const
@@ -343,6 +424,7 @@ void AWeapon::SetPawnOwner(ASurvivalCharacter* SChar)
 		PawnOwner = SChar;
 
 		SetOwner(SChar);
+		BindAmmoInventory();
 	}
 }
 
@@ -356,6 +438,11 @@ float AWeapon::GetEquipDuration() const
 	return EquipDuration;
 }
 
+const FProjectileConfig* AWeapon::GetProjectileConfig() const
+{
+	return bUseProjectiles ? &ProjectileConfig : nullptr;
+}
+
 void AWeapon::ClientStartReload_Implementation()
 {
 	StartReloadWep();
@@ -405,6 +492,7 @@ bool AWeapon::ServerStopReload_Validate()
 
 void AWeapon::OnRep_PawnOwner()
 {
+	BindAmmoInventory();
 }
 
 void AWeapon::OnRep_BurstCounter()
@@ -441,19 +529,36 @@ void AWeapon::SimulateWeaponFire()
 	{
 		if (!bLoopedMuzzleFX || MuzzlePSC == NULL)
 		{
+			//Looped muzzle FX are held until firing stops, one shot ones go back to the engine's pool by themselves
+			const EPSCPoolMethod PoolMethod = bLoopedMuzzleFX ? EPSCPoolMethod::ManualRelease : EPSCPoolMethod::AutoRelease;
+			UParticleSystemComponent* PSC = nullptr;
+
 			if ((PawnOwner != nullptr) && (PawnOwner->IsLocallyControlled() == true))
 			{
 				if (AController* PC = PawnOwner->GetController())
 				{
-					WeaponMesh->GetSocketLocation(MuzzleAttachPoint);
-					MuzzlePSC = UGameplayStatics::SpawnEmitterAttached(MuzzleFX, WeaponMesh, MuzzleAttachPoint);
-					MuzzlePSC->bOwnerNoSee = false;
-					MuzzlePSC->bOnlyOwnerSee = true;
+					PSC = UGameplayStatics::SpawnEmitterAttached(MuzzleFX, WeaponMesh, MuzzleAttachPoint, FVector::ZeroVector, FRotator::ZeroRotator, EAttachLocation::KeepRelativeOffset, true, PoolMethod);
+					if (PSC)
+					{
+						PSC->SetOwnerNoSee(false);
+						PSC->SetOnlyOwnerSee(true);
+					}
 				}
 			}
 			else
 			{
-				MuzzlePSC = UGameplayStatics::SpawnEmitterAttached(MuzzleFX, WeaponMesh, MuzzleAttachPoint);
+				PSC = UGameplayStatics::SpawnEmitterAttached(MuzzleFX, WeaponMesh, MuzzleAttachPoint, FVector::ZeroVector, FRotator::ZeroRotator, EAttachLocation::KeepRelativeOffset, true, PoolMethod);
+				if (PSC)
+				{
+					//Pooled components keep the visibility flags of their last use
+					PSC->SetOwnerNoSee(false);
+					PSC->SetOnlyOwnerSee(false);
+				}
+			}
+
+			if (bLoopedMuzzleFX)
+			{
+				MuzzlePSC = PSC;
 			}
 		}
 	}
@@ -500,6 +605,7 @@ void AWeapon::StopSimulatingWeaponFire()
 		if (MuzzlePSC != NULL)
 		{
 			MuzzlePSC->DeactivateSystem();
+			MuzzlePSC->ReleaseToPool();
 			MuzzlePSC = NULL;
 		}
 		if (MuzzlePSCSecondary != NULL)
@@ -525,11 +631,10 @@ void AWeapon::StopSimulatingWeaponFire()
 
 void AWeapon::HandleHit(const FHitResult& Hit, ASurvivalCharacter* SHitPlayer)
 {
-	if (Hit.GetActor())
+	if (ImpactParticles)
 	{
-		UE_LOG(LogTemp, Warning, TEXT("Hit actor %s"), *Hit.GetActor()->GetName());
+		UGameplayStatics::SpawnEmitterAtLocation(this, ImpactParticles, Hit.ImpactPoint, Hit.ImpactNormal.Rotation(), FVector(1.f), true, EPSCPoolMethod::AutoRelease);
 	}
-	ServerHandleHit(Hit, SHitPlayer);
 
 	if (SHitPlayer && PawnOwner)
 	{
@@ -540,31 +645,253 @@ void AWeapon::HandleHit(const FHitResult& Hit, ASurvivalCharacter* SHitPlayer)
 	}
 }
 
-void AWeapon::ServerHandleHit_Implementation(const FHitResult& Hit, ASurvivalCharacter* SHitPlayer)
+void AWeapon::QueueShot(const FVector& Origin, const FVector& Direction)
 {
-	if (PawnOwner)
+	const float ShotTime = ULagCompensationSubsystem::GetShotTime(GetWorld());
+
+	//The listen server's own shots don't need to go anywhere
+	if (HasAuthority())
 	{
-		float DamageMultiplier = 1.0f;
+		FWeaponShot Shot;
+		Shot.Origin = Origin;
+		Shot.Direction = Direction;
+		ResolveShots(TArray<FWeaponShot>({ Shot }), ShotTime, false);
+		return;
+	}
+
+	if (PendingShotBatch.Shots.Num() == 0)
+	{
+		PendingShotBatch.BaseTime = ShotTime;
+	}
+
+	FWeaponShot& Shot = PendingShotBatch.Shots.AddDefaulted_GetRef();
+	Shot.Origin = Origin;
+	Shot.Direction = Direction;
+	Shot.TimeOffsetMs = (uint16)FMath::Clamp(FMath::RoundToInt((ShotTime - PendingShotBatch.BaseTime) * 1000.f), 0, (int32)MAX_uint16);
+
+	//Batches stay small enough to fit a single packet
+	if (PendingShotBatch.Shots.Num() >= 16 || Shot.TimeOffsetMs == MAX_uint16)
+	{
+		FlushShotBatch();
+	}
+	else if (!GetWorldTimerManager().IsTimerActive(TimerHandle_FlushShotBatch))
+	{
+		GetWorldTimerManager().SetTimer(TimerHandle_FlushShotBatch, this, &AWeapon::FlushShotBatch, ShotBatchInterval, false);
+	}
+}
+
+void AWeapon::FlushShotBatch()
+{
+	GetWorldTimerManager().ClearTimer(TimerHandle_FlushShotBatch);
+
+	if (PendingShotBatch.Shots.Num() > 0)
+	{
+		PendingShotBatch.Sequence = ++NextShotBatchSequence;
+		ServerFireShotBatch(PendingShotBatch);
+		PendingShotBatch.Shots.Reset();
+	}
+}
+
+void AWeapon::ServerFireShotBatch_Implementation(const FWeaponShotBatch& Batch)
+{
+	//Sequence numbers wrap, anything up to half the range behind the last batch is old
+	if (bReceivedShotBatch && (int16)(Batch.Sequence - LastShotBatchSequence) <= 0)
+	{
+		UE_LOG(LogTemp, Verbose, TEXT("Dropped shot batch %d from %s, already resolved %d"), Batch.Sequence, *GetNameSafe(PawnOwner), LastShotBatchSequence);
+		return;
+	}
+
+	bReceivedShotBatch = true;
+	LastShotBatchSequence = Batch.Sequence;
+
+	ResolveShots(Batch.Shots, Batch.BaseTime, true);
+}
+
+bool AWeapon::ServerFireShotBatch_Validate(const FWeaponShotBatch& Batch)
+{
+	return Batch.Shots.Num() <= 16 && FMath::IsFinite(Batch.BaseTime);
+}
+
+void AWeapon::ResolveShots(const TArray<FWeaponShot>& Shots, const float BaseTime, const bool bUseClipAmmo)
+{
+	if (!PawnOwner || !HasAuthority())
+	{
+		return;
+	}
+
+	ULagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<ULagCompensationSubsystem>();
+
+	struct FShotTargetDamage
+	{
+		ASurvivalCharacter* Target;
+		float Damage;
+		FHitResult LastHit;
+	};
+	TArray<FShotTargetDamage, TInlineAllocator<4>> TargetDamages;
+
+	FCollisionQueryParams QParams(SCENE_QUERY_STAT(WeaponTrace), true, PawnOwner);
+	QParams.AddIgnoredActor(this);
+
+	//Characters are traced against their rewound hitboxes, so the world trace skips pawns where they are now
+	FCollisionResponseParams GeometryResponseParams;
+	GeometryResponseParams.CollisionResponse.SetResponse(ECC_Pawn, ECR_Ignore);
 
-		for (auto& BoneDamageModifier : HitScanConfig.BoneDamageModifier)
+	const float Now = ULagCompensationSubsystem::GetShotTime(GetWorld());
+	const float TimeBetweenShots = FMath::Max(WeaponConfig.TimeBetweenShots, 0.f);
+
+	TArray<FProjectileSeed> ProjectileSeeds;
+
+	int32 NumShotsFired = 0;
+	for (const FWeaponShot& Shot : Shots)
+	{
+		if (bUseClipAmmo && (CurrentAmmoInClip <= 0 || !CanFire()))
+		{
+			break;
+		}
+
+		const float ShotTime = BaseTime + Shot.TimeOffsetMs / 1000.f;
+
+		//Remote shots can't come faster than the fire rate. A client that hitched fires several shots in one frame with the same time,
+		//so each shot may borrow up to FireRateTolerance from when it was due. Times from the future count as now
+		if (bUseClipAmmo)
 		{
-			if (Hit.BoneName == BoneDamageModifier.Key)
+			const float RateCheckTime = FMath::Min(ShotTime, Now);
+			if (RateCheckTime < NextAllowedShotTime)
 			{
-				DamageMultiplier = BoneDamageModifier.Value;
-				break;
+				UE_LOG(LogTemp, Warning, TEXT("Rejected shot by %s: fired %.3fs before the fire rate allows"), *PawnOwner->GetName(), NextAllowedShotTime - RateCheckTime);
+				continue;
 			}
+			NextAllowedShotTime = FMath::Max(NextAllowedShotTime, RateCheckTime - FireRateTolerance) + TimeBetweenShots;
+
+			UseClipAmmo();
 		}
+		++NumShotsFired;
 
-		if (SHitPlayer)
+		if (bUseProjectiles)
 		{
-			UGameplayStatics::ApplyPointDamage(SHitPlayer, HitScanConfig.Damage * DamageMultiplier, (Hit.TraceStart - Hit.TraceEnd).GetSafeNormal(), Hit, PawnOwner->GetController(), this, HitScanConfig.DamageType);
+			FString RejectReason;
+			if (LagCompensation && !LagCompensation->CheckShot(PawnOwner, Shot.Origin, ShotTime, RejectReason))
+			{
+				UE_LOG(LogTemp, Warning, TEXT("Rejected shot by %s: %s"), *PawnOwner->GetName(), *RejectReason);
+				continue;
+			}
+
+			FProjectileSeed& Seed = ProjectileSeeds.AddDefaulted_GetRef();
+			Seed.Origin = Shot.Origin;
+			Seed.Direction = Shot.Direction;
+			Seed.LaunchTime = ShotTime;
+			Seed.ConfigSource = GetClass();
+			Seed.Causer = this;
+			continue;
 		}
+
+		const FVector TraceStart = Shot.Origin;
+		FVector TraceEnd = TraceStart + Shot.Direction.GetSafeNormal() * HitScanConfig.Distance;
+
+		FHitResult GeometryHit;
+		if (GetWorld()->LineTraceSingleByChannel(GeometryHit, TraceStart, TraceEnd, COLLISION_WEAPON, QParams, GeometryResponseParams))
+		{
+			TraceEnd = GeometryHit.ImpactPoint;
+		}
+
+		if (!LagCompensation)
+		{
+			continue;
+		}
+
+		ASurvivalCharacter* HitChar = nullptr;
+		FName BoneName;
+		int32 BoneIndex;
+		FVector HitLocation;
+		FString RejectReason;
+		if (!LagCompensation->TraceShot(PawnOwner, TraceStart, TraceEnd, ShotTime, HitChar, BoneName, BoneIndex, HitLocation, RejectReason))
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Rejected shot by %s: %s"), *PawnOwner->GetName(), *RejectReason);
+			continue;
+		}
+
+		if (HitChar)
+		{
+			const float DamageMultiplier = GetBoneDamageMultiplier(HitChar->GetMesh()->SkeletalMesh, BoneIndex);
+
+			FShotTargetDamage* TargetDamage = TargetDamages.FindByPredicate([HitChar](const FShotTargetDamage& Entry) { return Entry.Target == HitChar; });
+			if (!TargetDamage)
+			{
+				TargetDamage = &TargetDamages.Add_GetRef({ HitChar, 0.f, FHitResult(ForceInit) });
+			}
+
+			TargetDamage->Damage += HitScanConfig.Damage * DamageMultiplier;
+			TargetDamage->LastHit = FHitResult(HitChar, nullptr, HitLocation, -Shot.Direction);
+			TargetDamage->LastHit.BoneName = BoneName;
+			TargetDamage->LastHit.TraceStart = TraceStart;
+			TargetDamage->LastHit.TraceEnd = TraceEnd;
+		}
+	}
+
+	if (bUseClipAmmo && NumShotsFired > 0 && CurrentState == EWeaponState::Firing)
+	{
+		BurstCounter += NumShotsFired;
+		OnRep_BurstCounter();
+	}
+
+	for (const FShotTargetDamage& TargetDamage : TargetDamages)
+	{
+		UGameplayStatics::ApplyPointDamage(TargetDamage.Target, TargetDamage.Damage, (TargetDamage.LastHit.TraceEnd - TargetDamage.LastHit.TraceStart).GetSafeNormal(), TargetDamage.LastHit, PawnOwner->GetController(), this, HitScanConfig.DamageType);
+	}
+
+	if (ProjectileSeeds.Num() > 0)
+	{
+		if (UProjectileSubsystem* Projectiles = GetWorld()->GetSubsystem<UProjectileSubsystem>())
+		{
+			for (const FProjectileSeed& Seed : ProjectileSeeds)
+			{
+				Projectiles->LaunchProjectile(Seed);
+			}
+		}
+
+		MulticastLaunchProjectiles(ProjectileSeeds);
 	}
 }
 
-bool AWeapon::ServerHandleHit_Validate(const FHitResult& Hit, ASurvivalCharacter* SHitPlayer)
+void AWeapon::MulticastLaunchProjectiles_Implementation(const TArray<FProjectileSeed>& Seeds)
 {
-	return true;
+	if (HasAuthority() || (PawnOwner && PawnOwner->IsLocallyControlled()))
+	{
+		return;
+	}
+
+	if (UProjectileSubsystem* Projectiles = GetWorld()->GetSubsystem<UProjectileSubsystem>())
+	{
+		for (const FProjectileSeed& Seed : Seeds)
+		{
+			Projectiles->LaunchProjectile(Seed);
+		}
+	}
+}
+
+TSharedPtr<const TArray<float>> AWeapon::GetBoneDamageTable(const USkeletalMesh* Mesh)
+{
+	UBoneDamageSubsystem* BoneDamage = GetWorld() ? GetWorld()->GetSubsystem<UBoneDamageSubsystem>() : nullptr;
+	if (!BoneDamage)
+	{
+		return nullptr;
+	}
+
+	if (CachedBoneDamageTable.IsValid() && CachedBoneDamageMesh.Get() == Mesh && CachedBoneDamageTableGeneration == BoneDamage->GetGeneration())
+	{
+		return CachedBoneDamageTable;
+	}
+
+	CachedBoneDamageMesh = Mesh;
+	CachedBoneDamageTable = BoneDamage->GetBoneDamageTable(this, Mesh);
+	CachedBoneDamageTableGeneration = BoneDamage->GetGeneration();
+	return CachedBoneDamageTable;
+}
+
+float AWeapon::GetBoneDamageMultiplier(const USkeletalMesh* Mesh, const int32 BoneIndex)
+{
+	const TSharedPtr<const TArray<float>> Multipliers = GetBoneDamageTable(Mesh);
+	return Multipliers.IsValid() && Multipliers->IsValidIndex(BoneIndex) ? (*Multipliers)[BoneIndex] : 1.f;
 }
 
 void AWeapon::FireShot()
@@ -593,7 +920,26 @@ void AWeapon::FireShot()
 			const FVector TraceStart = CamLoc;
 			const FVector TraceEnd = (FireDir * HitScanConfig.Distance) + CamLoc;
 
-			if (GetWorld()->LineTraceSingleByChannel(Hit, TraceStart, TraceEnd, COLLISION_WEAPON, QParams))
+			QueueShot(TraceStart, FireDir);
+
+			if (bUseProjectiles)
+			{
+				//The owning client flies its own copy right away, the server's copy deals the damage
+				if (!HasAuthority())
+				{
+					if (UProjectileSubsystem* Projectiles = GetWorld()->GetSubsystem<UProjectileSubsystem>())
+					{
+						FProjectileSeed Seed;
+						Seed.Origin = TraceStart;
+						Seed.Direction = FireDir;
+						Seed.LaunchTime = ULagCompensationSubsystem::GetShotTime(GetWorld());
+						Seed.ConfigSource = GetClass();
+						Seed.Causer = this;
+						Projectiles->LaunchProjectile(Seed);
+					}
+				}
+			}
+			else if (GetWorld()->LineTraceSingleByChannel(Hit, TraceStart, TraceEnd, COLLISION_WEAPON, QParams))
 			{
 				ASurvivalCharacter* HitChar = Cast<ASurvivalCharacter>(Hit.GetActor());
 
@@ -609,17 +955,8 @@ void AWeapon::FireShot()
 
 void AWeapon::ServerHandleFiring_Implementation()
 {
-	const bool bShouldUpdateAmmo = (CurrentAmmoInClip > 0 && CanFire());
-
+	//Shots that were fired come in through the shot batches, this only lets the server start reloading
 	HandleFiring();
-
-	if (bShouldUpdateAmmo)
-	{
-		UseClipAmmo();
-
-		BurstCounter++;
-		OnRep_BurstCounter();
-	}
 }
 
 bool AWeapon::ServerHandleFiring_Validate()
@@ -627,22 +964,12 @@ bool AWeapon::ServerHandleFiring_Validate()
 	return true;
 }
 
-void AWeapon::HandleReFiring()
+void AWeapon::HandleFiring()
 {
-	const UWorld* MyWorld = GetWorld();
-
-	float StackTimeThisFrame = FMath::Max(0.0f, (MyWorld->TimeSeconds - LastFireTime) - WeaponConfig.TimeBetweenShots);
-
-	if (bAllowAutomaticWeaponCatchup)
-	{
-		TimerIntervalAdjustment -= StackTimeThisFrame;
-	}
+	UWeaponFireSubsystem* FireScheduler = GetWorld()->GetSubsystem<UWeaponFireSubsystem>();
 
-	HandleFiring();
-}
+	bool bFiredShot = false;
 
-void AWeapon::HandleFiring()
-{
 	if ((CurrentAmmoInClip > 0) && CanFire())
 	{
 		if (GetNetMode() != NM_DedicatedServer)
@@ -656,6 +983,7 @@ void AWeapon::HandleFiring()
 			UseClipAmmo();
 
 			BurstCounter++;
+			bFiredShot = true;
 		}
 	}
 	else if (CanReload())
@@ -678,7 +1006,7 @@ void AWeapon::HandleFiring()
 
 	if (PawnOwner && PawnOwner->IsLocallyControlled())
 	{
-		if (GetLocalRole() < ROLE_Authority)
+		if (GetLocalRole() < ROLE_Authority && !bFiredShot)
 		{
 			ServerHandleFiring();
 		}
@@ -688,12 +1016,16 @@ void AWeapon::HandleFiring()
 		}
 
 		bRefiring = (CurrentState == EWeaponState::Firing && WeaponConfig.TimeBetweenShots > 0.0f);
-		if (bRefiring)
+		if (bRefiring && FireScheduler)
 		{
-			GetWorldTimerManager().SetTimer(TimerHandle_HandleFiring, this, &AWeapon::HandleReFiring, FMath::Max<float>(WeaponConfig.TimeBetweenShots + TimerIntervalAdjustment, SMALL_NUMBER), false);
-			TimerIntervalAdjustment = 0.f;
+			FireScheduler->StartFiring(this, WeaponConfig.TimeBetweenShots);
 		}
 	}
+
+	if (!bRefiring && FireScheduler)
+	{
+		FireScheduler->StopFiring(this);
+	}
 	LastFireTime = GetWorld()->GetTimeSeconds();
 }
 
@@ -703,7 +1035,10 @@ void AWeapon::OnBurstStarted()
 
 	if (LastFireTime > 0.f && WeaponConfig.TimeBetweenShots > 0.f && LastFireTime + WeaponConfig.TimeBetweenShots > GameTime)
 	{
-		GetWorldTimerManager().SetTimer(TimerHandle_HandleFiring, this, &AWeapon::HandleFiring, LastFireTime + WeaponConfig.TimeBetweenShots - GameTime, false);
+		if (UWeaponFireSubsystem* FireScheduler = GetWorld()->GetSubsystem<UWeaponFireSubsystem>())
+		{
+			FireScheduler->StartFiring(this, LastFireTime + WeaponConfig.TimeBetweenShots - GameTime);
+		}
 	}
 	else
 	{
@@ -715,15 +1050,21 @@ void AWeapon::OnBurstFinished()
 {
 	BurstCounter = 0;
 
+	if (PawnOwner && PawnOwner->IsLocallyControlled())
+	{
+		FlushShotBatch();
+	}
+
 	if (GetNetMode() != NM_DedicatedServer)
 	{
 		StopSimulatingWeaponFire();
 	}
 
-	GetWorldTimerManager().ClearTimer(TimerHandle_HandleFiring);
+	if (UWeaponFireSubsystem* FireScheduler = GetWorld()->GetSubsystem<UWeaponFireSubsystem>())
+	{
+		FireScheduler->StopFiring(this);
+	}
 	bRefiring = false;
-
-	TimerIntervalAdjustment = 0.0f;
 }
 
 void AWeapon::SetWeaponState(EWeaponState NewState)
@@ -788,7 +1129,7 @@ UAudioComponent* AWeapon::PlayWeaponSound(USoundCue* Sound)
 	UAudioComponent* AC = NULL;
 	if (Sound && PawnOwner)
 	{
-		AC = UGameplayStatics::SpawnSoundAttached(Sound, GetOwner()->GetRootComponent());
+		AC = UFXPoolSubsystem::SpawnSoundAttached(Sound, GetOwner()->GetRootComponent());
 	}
 	return AC;
 }
@@ -4,6 +4,8 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "Engine/NetSerialization.h"
+#include "Weapons/ProjectileSubsystem.h"
 #include "Weapon.generated.h"
 
 UENUM(BlueprintType)
@@ -61,6 +63,8 @@ struct FHitScanConfig
 		DamageType = /*class*/ UDamageType::StaticClass();
 	}
 
+	//Hitscan shots only report the bones ULagCompensationSubsystem buffers (head, spine_03, pelvis, upper arms, thighs and
+	//calves), modifiers on other bones only apply to projectile hits. A warning is logged for the ones that can't apply
 	UPROPERTY(EditDefaultsOnly, Category = "TraceInfo")
 	TMap<FName, float> BoneDamageModifier;
 
@@ -77,12 +81,63 @@ struct FHitScanConfig
 	TSubclassOf<class UDamageType> DamageType;
 
 };
+//A shot as the owning client fired it, quantized for the shot batch RPC
+USTRUCT()
+struct FWeaponShot
+{
+	GENERATED_USTRUCT_BODY()
+
+	FWeaponShot()
+	{
+		TimeOffsetMs = 0;
+	}
+
+	UPROPERTY()
+	FVector_NetQuantize Origin;
+
+	UPROPERTY()
+	FVector_NetQuantizeNormal Direction;
+
+	//When the shot was fired, in milliseconds after the batch's BaseTime
+	UPROPERTY()
+	uint16 TimeOffsetMs;
+};
+
+//Every shot the owning client fired since its last batch
+USTRUCT()
+struct FWeaponShotBatch
+{
+	GENERATED_USTRUCT_BODY()
+
+	FWeaponShotBatch()
+	{
+		Sequence = 0;
+		BaseTime = 0.f;
+	}
+
+	//Batches are sent unreliably, the server drops any that arrive after a newer one
+	UPROPERTY()
+	uint16 Sequence;
+
+	//Server clock time of the first shot
+	UPROPERTY()
+	float BaseTime;
+
+	UPROPERTY()
+	TArray<FWeaponShot> Shots;
+};
+
 UCLASS()
 class SURVIVALGAME_API AWeapon : public AActor
 {
 	GENERATED_BODY()
 
 	friend class ASurvivalCharacter;
+	friend class FInventorySnapshotWriter;
+	friend class FInventorySnapshotReader;
+	friend class UProjectileSubsystem;
+	friend class UWeaponFireSubsystem;
+	friend class UBoneDamageSubsystem;
 
 public:	
 	// Sets default values for this actor's properties
@@ -99,6 +154,10 @@ protected:
 	void ConsumeAmmo(const int32 Amount);
 	void ReturnAmmoToInventory(); // server
 
+	//Follows the pawn owner's inventory so the reserve ammo count only gets recomputed when the ammo class changes
+	void BindAmmoInventory();
+	void OnInventoryClassChanged(UClass* ItemClass);
+
 	virtual void OnEquip();
 	virtual void OnEquipFinished();
 	virtual void OnUnEquip();
@@ -141,6 +200,11 @@ protected:
 	float GetEquipStartedTime() const;
 	float GetEquipDuration() const;
 
+public:
+
+	//Null unless the weapon fires simulated projectiles instead of hitscan shots
+	const FProjectileConfig* GetProjectileConfig() const;
+
 protected:
 
 	UPROPERTY(Replicated, BlueprintReadOnly, Transient)
@@ -154,6 +218,13 @@ protected:
 	
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Config)
 	FHitScanConfig HitScanConfig;
+
+	//Fire simulated projectiles instead of hitscan shots
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Config)
+	bool bUseProjectiles;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Config, meta = (EditCondition = "bUseProjectiles"))
+	FProjectileConfig ProjectileConfig;
 	
 
 public:
@@ -162,12 +233,6 @@ public:
 	USkeletalMeshComponent* WeaponMesh;
 
 protected:
-	UPROPERTY(Transient)
-	float TimerIntervalAdjustment;
-
-	UPROPERTY(Config)
-	bool bAllowAutomaticWeaponCatchup = true;
-
 	UPROPERTY(Transient)
 	class UAudioComponent* FireAC;
 	
@@ -278,7 +343,40 @@ protected:
 
 	FTimerHandle TimerHandle_ReloadWeapon;
 
-	FTimerHandle TimerHandle_HandleFiring;
+	FTimerHandle TimerHandle_FlushShotBatch;
+
+	//Longest a fired shot waits before its batch is sent
+	UPROPERTY(EditDefaultsOnly, Category = Config)
+	float ShotBatchInterval;
+
+	//Shots fired locally that haven't been sent yet
+	FWeaponShotBatch PendingShotBatch;
+
+	uint16 NextShotBatchSequence;
+
+	//The table of the mesh we last hit, most targets share one mesh
+	TWeakObjectPtr<const USkeletalMesh> CachedBoneDamageMesh;
+	TSharedPtr<const TArray<float>> CachedBoneDamageTable;
+	uint32 CachedBoneDamageTableGeneration;
+
+	//Inventory the reserve ammo is counted in
+	TWeakObjectPtr<class UInventoryComponent> AmmoInventory;
+	FDelegateHandle AmmoInventoryChangedHandle;
+
+	//Ammo of WeaponConfig.AmmoClass held in AmmoInventory, recounted on the next query once it is dirty
+	mutable int32 CachedReserveAmmo;
+	mutable bool bReserveAmmoDirty;
+
+	//Server side, sequence of the newest batch resolved
+	uint16 LastShotBatchSequence;
+	bool bReceivedShotBatch;
+
+	//How far ahead of the fire rate a remote shot may be, for shots a hitching client fired in the same frame
+	UPROPERTY(EditDefaultsOnly, Category = Config)
+	float FireRateTolerance;
+
+	//Server side, the earliest the next remote shot may have been fired
+	float NextAllowedShotTime;
 	//////////////////////////////////////////////////////////////////////////
 // Input - server side
 
@@ -311,18 +409,38 @@ protected:
 	//////////////////////////////////////////////////////////////////////////
 // Weapon usage
 
+	//Local hit feedback, the server works out hits itself from the shot batches
 	void HandleHit(const FHitResult& Hit, class ASurvivalCharacter* SHitPlayer = nullptr);
-	
-	UFUNCTION(Server, reliable, WithValidation)
-	void ServerHandleHit(const FHitResult& Hit, class ASurvivalCharacter* SHitPlayer = nullptr);
+
+	//Adds a locally fired shot to the batch sent to the server
+	void QueueShot(const FVector& Origin, const FVector& Direction);
+
+	void FlushShotBatch();
+
+	UFUNCTION(Server, Unreliable, WithValidation)
+	void ServerFireShotBatch(const FWeaponShotBatch& Batch);
+
+	/**Server side. Traces every shot against the world and the rewound hitboxes of every character, then
+	applies the damage each target took in one go. Projectile weapons launch a projectile per shot instead.
+	Remote shots also use up clip ammo.*/
+	void ResolveShots(const TArray<FWeaponShot>& Shots, const float BaseTime, const bool bUseClipAmmo);
+
+	//Launches the projectiles the server fired everywhere but the server and the owning client, which launched its own
+	UFUNCTION(NetMulticast, Unreliable)
+	void MulticastLaunchProjectiles(const TArray<FProjectileSeed>& Seeds);
+
+	/**Damage multiplier of every bone of Mesh for this weapon class, indexed by the mesh's bone index.
+	Shared by every weapon of the class through UBoneDamageSubsystem, null if the world has none.*/
+	TSharedPtr<const TArray<float>> GetBoneDamageTable(const USkeletalMesh* Mesh);
+
+	float GetBoneDamageMultiplier(const USkeletalMesh* Mesh, const int32 BoneIndex);
 
 	virtual void FireShot();// Local
 
 	UFUNCTION(reliable, server, WithValidation)
 	void ServerHandleFiring();// Server
 
-	void HandleReFiring();// Local + Server
-
+	//Refiring is driven by the weapon fire subsystem
 	void HandleFiring();// Local + Server
 
 	virtual void OnBurstStarted();// Local + Server
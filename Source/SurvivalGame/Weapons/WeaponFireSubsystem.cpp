@@ -0,0 +1,99 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "WeaponFireSubsystem.h"
+#include "Weapons/Weapon.h"
+
+UWeaponFireSubsystem::UWeaponFireSubsystem()
+{
+	bInitialized = false;
+	MaxShotsPerTick = 8;
+}
+
+void UWeaponFireSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	bInitialized = true;
+}
+
+void UWeaponFireSubsystem::Deinitialize()
+{
+	bInitialized = false;
+	FiringWeapons.Empty();
+
+	Super::Deinitialize();
+}
+
+ETickableTickType UWeaponFireSubsystem::GetTickableTickType() const
+{
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+bool UWeaponFireSubsystem::IsTickable() const
+{
+	return bInitialized && FiringWeapons.Num() > 0;
+}
+
+TStatId UWeaponFireSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UWeaponFireSubsystem, STATGROUP_Tickables);
+}
+
+void UWeaponFireSubsystem::Tick(float DeltaTime)
+{
+	const float Now = GetWorld()->GetTimeSeconds();
+
+	//Backwards, a weapon that stops firing swaps the last entry into its place and that one has already been handled
+	for (int32 Index = FiringWeapons.Num() - 1; Index >= 0; --Index)
+	{
+		AWeapon* Weapon = FiringWeapons[Index].Weapon.Get();
+		if (!Weapon)
+		{
+			FiringWeapons.RemoveAtSwap(Index, 1, false);
+			continue;
+		}
+
+		int32 NumShots = 0;
+		while (FiringWeapons.IsValidIndex(Index) && FiringWeapons[Index].Weapon == Weapon && FiringWeapons[Index].NextShotTime <= Now)
+		{
+			if (NumShots >= MaxShotsPerTick)
+			{
+				FiringWeapons[Index].NextShotTime = Now;
+				break;
+			}
+
+			//Added before firing, the shot can stop the weapon and remove the entry
+			FiringWeapons[Index].NextShotTime += FMath::Max(Weapon->WeaponConfig.TimeBetweenShots, SMALL_NUMBER);
+			++NumShots;
+
+			Weapon->HandleFiring();
+		}
+	}
+}
+
+void UWeaponFireSubsystem::StartFiring(AWeapon* Weapon, const float Delay)
+{
+	if (!Weapon || IsFiring(Weapon))
+	{
+		return;
+	}
+
+	FScheduledWeaponFire& FiringWeapon = FiringWeapons.AddDefaulted_GetRef();
+	FiringWeapon.Weapon = Weapon;
+	//Absolute, so a weapon that starts firing during this frame isn't also charged this frame's time
+	FiringWeapon.NextShotTime = GetWorld()->GetTimeSeconds() + Delay;
+}
+
+void UWeaponFireSubsystem::StopFiring(AWeapon* Weapon)
+{
+	const int32 Index = FiringWeapons.IndexOfByPredicate([Weapon](const FScheduledWeaponFire& FiringWeapon) { return FiringWeapon.Weapon.Get() == Weapon; });
+	if (Index != INDEX_NONE)
+	{
+		FiringWeapons.RemoveAtSwap(Index, 1, false);
+	}
+}
+
+bool UWeaponFireSubsystem::IsFiring(const AWeapon* Weapon) const
+{
+	return FiringWeapons.ContainsByPredicate([Weapon](const FScheduledWeaponFire& FiringWeapon) { return FiringWeapon.Weapon.Get() == Weapon; });
+}
@@ -0,0 +1,57 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "WeaponFireSubsystem.generated.h"
+
+class AWeapon;
+
+//A weapon that is firing. NextShotTime is absolute world time, so what a frame overshot by carries over to the next shot
+struct FScheduledWeaponFire
+{
+	FScheduledWeaponFire() : NextShotTime(0.f) {};
+
+	TWeakObjectPtr<AWeapon> Weapon;
+	float NextShotTime;
+};
+
+/**
+ * Drives the refire of every firing weapon from one tick. Each weapon keeps the world time its next shot is due
+ * and fires as many shots as are due, so fire rates hold at any frame or server tick rate.
+ */
+UCLASS()
+class SURVIVALGAME_API UWeaponFireSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+
+	UWeaponFireSubsystem();
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+
+	//Fires the weapon again after Delay and then every time between shots, does nothing if it is already firing
+	void StartFiring(AWeapon* Weapon, const float Delay);
+
+	void StopFiring(AWeapon* Weapon);
+
+	bool IsFiring(const AWeapon* Weapon) const;
+
+protected:
+
+	bool bInitialized;
+
+	//Shots a weapon fires in one frame at most, a long hitch drops the rest
+	int32 MaxShotsPerTick;
+
+	TArray<FScheduledWeaponFire> FiringWeapons;
+};
@@ -4,9 +4,67 @@
 #include "InteractionWidget.h"
 #include "../Components/InteractionComponent.h"
 
+static bool HasTextChanged(const FText& NewText, const FText& OldText)
+{
+	return !NewText.IdenticalTo(OldText) && !NewText.EqualTo(OldText);
+}
+
+UInteractionWidget::UInteractionWidget(const FObjectInitializer& ObjectInitializer) : Super(ObjectInitializer)
+{
+	InteractPercentage = 0.f;
+	InteractionStartTime = -1.f;
+	InteractionDuration = 0.f;
+}
 
 void UInteractionWidget::UpdateInteractionWidget(class UInteractionComponent* InteractionComponent)
 {
+	const float NewStartTime = InteractionComponent ? InteractionComponent->GetInteractionStartTime() : -1.f;
+	const float NewDuration = InteractionComponent ? InteractionComponent->InteractionTime : 0.f;
+
+	if (InteractionComponent == OwningInteractionComponent && InteractionComponent
+		&& !HasTextChanged(InteractionComponent->InteractableNameText, LastNameText)
+		&& !HasTextChanged(InteractionComponent->InteractableActionText, LastActionText)
+		&& NewStartTime == InteractionStartTime && NewDuration == InteractionDuration)
+	{
+		return;
+	}
+
 	OwningInteractionComponent = InteractionComponent;
+	InteractionStartTime = NewStartTime;
+	InteractionDuration = NewDuration;
+	LastNameText = InteractionComponent ? InteractionComponent->InteractableNameText : FText::GetEmpty();
+	LastActionText = InteractionComponent ? InteractionComponent->InteractableActionText : FText::GetEmpty();
+	UpdateInteractPercentage();
+
 	OnUpdateInteractionWidget();
 }
+
+void UInteractionWidget::ClearInteractionWidget()
+{
+	OwningInteractionComponent = nullptr;
+	InteractPercentage = 0.f;
+	InteractionStartTime = -1.f;
+	InteractionDuration = 0.f;
+	LastNameText = FText::GetEmpty();
+	LastActionText = FText::GetEmpty();
+}
+
+void UInteractionWidget::NativeTick(const FGeometry& MyGeometry, float InDeltaTime)
+{
+	Super::NativeTick(MyGeometry, InDeltaTime);
+
+	UpdateInteractPercentage();
+}
+
+void UInteractionWidget::UpdateInteractPercentage()
+{
+	//The component publishes start and duration once, the progress in between is ours to work out
+	if (InteractionStartTime >= 0.f && InteractionDuration > 0.f)
+	{
+		InteractPercentage = FMath::Clamp((UInteractionComponent::GetInteractionClockTime(GetWorld()) - InteractionStartTime) / InteractionDuration, 0.f, 1.f);
+	}
+	else
+	{
+		InteractPercentage = 0.f;
+	}
+}
@@ -15,12 +15,38 @@ class SURVIVALGAME_API UInteractionWidget : public UUserWidget
 	GENERATED_BODY()
 	
 public:
+	UInteractionWidget(const FObjectInitializer& ObjectInitializer);
+
+	//Only calls OnUpdateInteractionWidget if the component, its texts or when its interaction started changed
 	UFUNCTION(BlueprintCallable, Category = "Interaction")
 	void UpdateInteractionWidget(class UInteractionComponent* InteractionComponent);
 
+	//Detaches the widget from its component without notifying blueprint
+	void ClearInteractionWidget();
+
 	UFUNCTION(BlueprintImplementableEvent)
 	void OnUpdateInteractionWidget();
 
 	UPROPERTY(BlueprintReadOnly, Category = "Interaction", meta = (ExposeOnSpawn))
 	class UInteractionComponent* OwningInteractionComponent;
+
+	//Interaction progress of the owning component, computed every tick from the start time and duration it published
+	UPROPERTY(BlueprintReadOnly, Category = "Interaction")
+	float InteractPercentage;
+
+	//Interaction clock time the owning component's interaction started at, negative while nobody is interacting
+	UPROPERTY(BlueprintReadOnly, Category = "Interaction")
+	float InteractionStartTime;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Interaction")
+	float InteractionDuration;
+
+protected:
+	virtual void NativeTick(const FGeometry& MyGeometry, float InDeltaTime) override;
+
+	void UpdateInteractPercentage();
+
+	//What the widget showed the last time it was updated
+	FText LastNameText;
+	FText LastActionText;
 };
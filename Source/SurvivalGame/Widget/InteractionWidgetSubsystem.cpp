@@ -0,0 +1,62 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "InteractionWidgetSubsystem.h"
+#include "InteractionWidget.h"
+#include "Engine/LocalPlayer.h"
+#include "GameFramework/PlayerController.h"
+
+void UInteractionWidgetSubsystem::Deinitialize()
+{
+	Widgets.Empty();
+
+	Super::Deinitialize();
+}
+
+UInteractionWidget* UInteractionWidgetSubsystem::AcquireWidget(UInteractionComponent* InteractionComponent, TSubclassOf<UInteractionWidget> WidgetClass, APlayerController* OwningPlayer)
+{
+	ULocalPlayer* LocalPlayer = OwningPlayer ? OwningPlayer->GetLocalPlayer() : nullptr;
+	if (UInteractionWidgetSubsystem* WidgetSubsystem = LocalPlayer ? LocalPlayer->GetSubsystem<UInteractionWidgetSubsystem>() : nullptr)
+	{
+		return WidgetSubsystem->Acquire(InteractionComponent, WidgetClass, OwningPlayer);
+	}
+	return nullptr;
+}
+
+void UInteractionWidgetSubsystem::ReleaseWidget(UInteractionWidget* Widget, UInteractionComponent* InteractionComponent)
+{
+	ULocalPlayer* LocalPlayer = Widget ? Widget->GetOwningLocalPlayer() : nullptr;
+	if (UInteractionWidgetSubsystem* WidgetSubsystem = LocalPlayer ? LocalPlayer->GetSubsystem<UInteractionWidgetSubsystem>() : nullptr)
+	{
+		WidgetSubsystem->Release(Widget, InteractionComponent);
+	}
+}
+
+UInteractionWidget* UInteractionWidgetSubsystem::Acquire(UInteractionComponent* InteractionComponent, TSubclassOf<UInteractionWidget> WidgetClass, APlayerController* OwningPlayer)
+{
+	if (!WidgetClass || !OwningPlayer)
+	{
+		return nullptr;
+	}
+
+	UInteractionWidget*& Widget = Widgets.FindOrAdd(WidgetClass);
+
+	//The player controller is replaced on map travel, the old widget belongs to the old one
+	if (!Widget || Widget->IsPendingKill() || Widget->GetOwningPlayer() != OwningPlayer)
+	{
+		Widget = CreateWidget<UInteractionWidget>(OwningPlayer, WidgetClass);
+	}
+
+	if (Widget)
+	{
+		Widget->UpdateInteractionWidget(InteractionComponent);
+	}
+	return Widget;
+}
+
+void UInteractionWidgetSubsystem::Release(UInteractionWidget* Widget, UInteractionComponent* InteractionComponent)
+{
+	if (Widget && Widget->OwningInteractionComponent == InteractionComponent)
+	{
+		Widget->ClearInteractionWidget();
+	}
+}
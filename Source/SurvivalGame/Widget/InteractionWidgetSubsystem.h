@@ -0,0 +1,42 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/LocalPlayerSubsystem.h"
+#include "InteractionWidgetSubsystem.generated.h"
+
+class UInteractionWidget;
+class UInteractionComponent;
+class APlayerController;
+
+/**
+ * Holds the one interaction widget each local player needs, per widget class. Interaction components
+ * borrow it while they are focused instead of every interactable in the level owning a widget.
+ */
+UCLASS()
+class SURVIVALGAME_API UInteractionWidgetSubsystem : public ULocalPlayerSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void Deinitialize() override;
+
+	/**Returns the interaction widget of the player that focused the component, creating it the first time.
+	Returns null for characters that aren't locally controlled by a player.*/
+	static UInteractionWidget* AcquireWidget(UInteractionComponent* InteractionComponent, TSubclassOf<UInteractionWidget> WidgetClass, APlayerController* OwningPlayer);
+
+	//Hands the widget back once the component that borrowed it loses focus
+	static void ReleaseWidget(UInteractionWidget* Widget, UInteractionComponent* InteractionComponent);
+
+	UInteractionWidget* Acquire(UInteractionComponent* InteractionComponent, TSubclassOf<UInteractionWidget> WidgetClass, APlayerController* OwningPlayer);
+
+	//Detaches the widget from the component it was borrowed by
+	void Release(UInteractionWidget* Widget, UInteractionComponent* InteractionComponent);
+
+protected:
+
+	UPROPERTY()
+	TMap<UClass*, UInteractionWidget*> Widgets;
+};
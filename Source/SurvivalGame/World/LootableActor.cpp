@@ -26,6 +26,7 @@ ALootableActor::ALootableActor()
 	LootInventoryComponent = CreateDefaultSubobject<UInventoryComponent>("LootInventoryComponent");
 	LootInventoryComponent->SetCapacity(20);
 	LootInventoryComponent->SetWeightCapacity(80.0f);
+	LootInventoryComponent->SetUseCompactStorage(true);
 
 	LootRoll = FIntPoint(2, 8);
 
@@ -43,6 +44,8 @@ void ALootableActor::BeginPlay()
 		TArray<FLootTableRow*> SpawnItems;
 		LootTable->GetAllRows("", SpawnItems);
 
+		FInventoryBatchScope LootBatch(LootInventoryComponent);
+
 		int32 Rolls = FMath::RandRange(LootRoll.GetMin(), LootRoll.GetMax());
 		for (int32 i = 0 ; i < Rolls; ++i)
 		{
@@ -65,7 +68,7 @@ void ALootableActor::BeginPlay()
 					if (ItemClass)
 					{
 						const int32 Quantity = Cast<UItem>(ItemClass->GetDefaultObject())->GetQuantity();
-						LootInventoryComponent->TryAddItemFromClass(ItemClass, Quantity);
+						LootBatch.TryAddItemFromClass(ItemClass, Quantity);
 					}
 				}
 			}
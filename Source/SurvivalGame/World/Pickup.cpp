@@ -4,6 +4,7 @@
 #include "Pickup.h"
 #include "Net/UnrealNetwork.h"
 #include "Items/Item.h"
+#include "Items/ItemPoolSubsystem.h"
 #include "Engine/ActorChannel.h"
 #include "Components/StaticMeshComponent.h"
 #include "Components/InteractionComponent.h"
@@ -33,7 +34,13 @@ void APickup::InitializePickup(const TSubclassOf<class UItem> ItemClass, const i
 {
 	if (HasAuthority() && ItemClass && Quantity > 0)
 	{
-		Item = NewObject<UItem>(this, ItemClass);
+		if (Item)
+		{
+			Item->OnItemModified.RemoveDynamic(this, &APickup::OnItemModified);
+			UItemPoolSubsystem::ReleaseItem(GetWorld(), Item);
+		}
+
+		Item = UItemPoolSubsystem::AcquireItem(GetWorld(), ItemClass, this);
 		Item->SetQuantity(Quantity);
 		OnRep_Item();
 
@@ -80,6 +87,17 @@ void APickup::BeginPlay()
 	}
 }
 
+void APickup::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (HasAuthority() && Item)
+	{
+		UItemPoolSubsystem::ReleaseItem(GetWorld(), Item);
+		Item = nullptr;
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
 void APickup::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
@@ -111,6 +129,7 @@ void APickup::OnTakePickup(class ASurvivalCharacter* Taker)
 		if (UInventoryComponent* PlayerInventory = Taker->PlayerInventoryComponent)
 		{
 			const FItemAddResult AddResult = PlayerInventory->TryAddItem(Item);
+			PlayerInventory->AcknowledgePrediction(Taker->ConsumeInteractPredictionKey(), AddResult.AmountActuallyGiven);
 
 			if (AddResult.AmountActuallyGiven < Item->GetQuantity())
 			{
@@ -123,6 +142,14 @@ void APickup::OnTakePickup(class ASurvivalCharacter* Taker)
 			}
 		}
 	}
+	else if (!HasAuthority() && Taker->IsLocallyControlled() && Item)
+	{
+		//Show the items in the inventory now, the server's answer confirms or rolls them back
+		if (UInventoryComponent* PlayerInventory = Taker->PlayerInventoryComponent)
+		{
+			PlayerInventory->PredictAddItem(Taker->GetInteractPredictionKey(), Item->GetClass(), Item->GetQuantity(), this);
+		}
+	}
 }
 
 #if WITH_EDITOR
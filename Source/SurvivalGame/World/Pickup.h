@@ -17,6 +17,8 @@ public:
 
 	void InitializePickup(const TSubclassOf<class UItem> ItemClass, const int32 Quantity);
 
+	FORCEINLINE class UItem* GetItem() const { return Item; };
+
 	UFUNCTION(BlueprintImplementableEvent)
 	void AllignWithGround();
 
@@ -36,6 +38,7 @@ protected:
 
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
 	virtual bool ReplicateSubobjects(class UActorChannel* Channel, class FOutBunch* Bunch, FReplicationFlags* RepFlags) override;
@@ -0,0 +1,315 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "InventoryBenchmark.h"
+#include "Components/InventoryComponent.h"
+#include "Framework/InventorySnapshot.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+UBenchmarkStackableItem::UBenchmarkStackableItem()
+{
+	bStackable = true;
+	MaxStackSize = 100000;
+	Weight = 0.1f;
+}
+
+UBenchmarkUnstackableItem::UBenchmarkUnstackableItem()
+{
+	bStackable = false;
+	Weight = 1.f;
+}
+
+#if !UE_BUILD_SHIPPING
+
+namespace InventoryBenchmark
+{
+	static const int32 InventorySizes[] = { 10, 100, 300 };
+
+	struct FResult
+	{
+		FString Operation;
+		int32 InventorySize;
+		int32 Iterations;
+		double TotalSeconds;
+	};
+
+	static TArray<TSubclassOf<UItem>> GetItemClasses()
+	{
+		return { UBenchmarkStackableItem::StaticClass(), UBenchmarkStackableItemB::StaticClass(), UBenchmarkStackableItemC::StaticClass(),
+			UBenchmarkUnstackableItem::StaticClass(), UBenchmarkUnstackableItemB::StaticClass() };
+	}
+
+	static UInventoryComponent* CreateInventory(AActor* Owner, const int32 Size)
+	{
+		UInventoryComponent* Inventory = NewObject<UInventoryComponent>(Owner);
+		Inventory->SetCapacity(Size);
+		Inventory->SetWeightCapacity(MAX_flt);
+		Inventory->RegisterComponent();
+		return Inventory;
+	}
+
+	//Fills the inventory with one stack per slot, cycling through the synthetic classes
+	static void FillInventory(UInventoryComponent* Inventory, const TArray<UItem*>& Templates, const int32 Size, FResult& OutResult)
+	{
+		//A stackable only opens a new slot once its stacks reach MaxStackSize, so add one of each and fill the rest with unstackables
+		const int32 NumStackable = 3;
+		const double StartTime = FPlatformTime::Seconds();
+		for (int32 i = 0; i < Size; ++i)
+		{
+			const int32 ClassIndex = i < NumStackable ? i : NumStackable + (i % (Templates.Num() - NumStackable));
+			Inventory->TryAddItem(Templates[ClassIndex]);
+		}
+		OutResult.TotalSeconds = FPlatformTime::Seconds() - StartTime;
+		OutResult.Iterations = Size;
+	}
+
+	static void Run(UWorld* World, const int32 Iterations, TArray<FResult>& OutResults)
+	{
+		const TArray<TSubclassOf<UItem>> ItemClasses = GetItemClasses();
+
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.ObjectFlags |= RF_Transient;
+		AActor* Owner = World->SpawnActor<AActor>(AActor::StaticClass(), FTransform::Identity, SpawnParams);
+		if (!Owner)
+		{
+			return;
+		}
+
+		TArray<UItem*> Templates;
+		for (const TSubclassOf<UItem>& ItemClass : ItemClasses)
+		{
+			UItem* Template = NewObject<UItem>(Owner, ItemClass);
+			Template->SetQuantity(1);
+			Templates.Add(Template);
+		}
+
+		for (const int32 Size : InventorySizes)
+		{
+			UInventoryComponent* Inventory = CreateInventory(Owner, Size);
+
+			FResult AddResult { TEXT("TryAddItem"), Size, 0, 0.0 };
+			FillInventory(Inventory, Templates, Size, AddResult);
+			OutResults.Add(AddResult);
+
+			const TArray<UItem*> Items = Inventory->GetItems();
+			double StartTime = 0.0;
+
+			StartTime = FPlatformTime::Seconds();
+			for (int32 i = 0; i < Iterations; ++i)
+			{
+				Inventory->FindItemByClass(ItemClasses[i % ItemClasses.Num()]);
+			}
+			OutResults.Add({ TEXT("FindItemByClass"), Size, Iterations, FPlatformTime::Seconds() - StartTime });
+
+			StartTime = FPlatformTime::Seconds();
+			for (int32 i = 0; i < Iterations; ++i)
+			{
+				Inventory->GetCurrentWeight();
+			}
+			OutResults.Add({ TEXT("GetCurrentWeight"), Size, Iterations, FPlatformTime::Seconds() - StartTime });
+
+			//Adding into existing stacks, the common pickup path once the inventory is full of slots
+			UItem* StackTemplate = Templates[0];
+			StartTime = FPlatformTime::Seconds();
+			for (int32 i = 0; i < Iterations; ++i)
+			{
+				Inventory->TryAddItem(StackTemplate);
+			}
+			OutResults.Add({ TEXT("TryAddItemToStack"), Size, Iterations, FPlatformTime::Seconds() - StartTime });
+
+			//Stops early if the stack runs down to its last item, only the consumes that ran are counted
+			UItem* StackItem = Inventory->FindItemByClass(StackTemplate->GetClass());
+			int32 NumConsumed = 0;
+			StartTime = FPlatformTime::Seconds();
+			for (; NumConsumed < Iterations && StackItem && StackItem->GetQuantity() > 1; ++NumConsumed)
+			{
+				Inventory->ConsumeItem(StackItem, 1);
+			}
+			OutResults.Add({ TEXT("ConsumeItem"), Size, NumConsumed, FPlatformTime::Seconds() - StartTime });
+
+			//Every quantity change bumps the item and inventory replication keys
+			StartTime = FPlatformTime::Seconds();
+			for (int32 i = 0; i < Iterations; ++i)
+			{
+				if (UItem* Item = Items[i % Items.Num()])
+				{
+					if (Item->bStackable)
+					{
+						Item->SetQuantity(Item->GetQuantity() % 2 ? Item->GetQuantity() + 1 : Item->GetQuantity() - 1);
+					}
+					else
+					{
+						Item->MarkDirtyForReplication();
+					}
+				}
+			}
+			OutResults.Add({ TEXT("ReplicationKeyChurn"), Size, Iterations, FPlatformTime::Seconds() - StartTime });
+
+			//Remove from the front so every removal has to shift the index of all later items
+			const TArray<UItem*> ItemsToRemove = Inventory->GetItems();
+			StartTime = FPlatformTime::Seconds();
+			for (UItem* Item : ItemsToRemove)
+			{
+				Inventory->RemoveItem(Item);
+			}
+			OutResults.Add({ TEXT("RemoveItem"), Size, ItemsToRemove.Num(), FPlatformTime::Seconds() - StartTime });
+
+			Inventory->DestroyComponent();
+		}
+
+		Owner->Destroy();
+	}
+
+	static void RunSnapshot(UWorld* World, const int32 NumContainers, TArray<FResult>& OutResults)
+	{
+		const TArray<TSubclassOf<UItem>> ItemClasses = GetItemClasses();
+		const int32 StacksPerContainer = 20;
+
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.ObjectFlags |= RF_Transient;
+		AActor* Owner = World->SpawnActor<AActor>(AActor::StaticClass(), FTransform::Identity, SpawnParams);
+		if (!Owner)
+		{
+			return;
+		}
+
+		//Half the containers use compact storage so both entry layouts are covered
+		TArray<UInventoryComponent*> Inventories;
+		for (int32 i = 0; i < NumContainers; ++i)
+		{
+			UInventoryComponent* Inventory = CreateInventory(Owner, StacksPerContainer);
+			Inventory->SetUseCompactStorage(i % 2 == 0);
+
+			FInventoryBatchScope FillBatch(Inventory);
+			for (int32 Stack = 0; Stack < StacksPerContainer; ++Stack)
+			{
+				FillBatch.TryAddItemFromClass(ItemClasses[Stack % ItemClasses.Num()], 1 + (Stack * 7) % 50);
+			}
+			Inventories.Add(Inventory);
+		}
+
+		double StartTime = FPlatformTime::Seconds();
+		FInventorySnapshotWriter Writer;
+		for (UInventoryComponent* Inventory : Inventories)
+		{
+			Writer.WriteInventory(Inventory);
+		}
+		OutResults.Add({ TEXT("SnapshotCapture"), StacksPerContainer, NumContainers, FPlatformTime::Seconds() - StartTime });
+
+		TArray<uint8> SnapshotData;
+		StartTime = FPlatformTime::Seconds();
+		Writer.Finalize(SnapshotData);
+		OutResults.Add({ TEXT("SnapshotFinalize"), StacksPerContainer, NumContainers, FPlatformTime::Seconds() - StartTime });
+
+		StartTime = FPlatformTime::Seconds();
+		FInventorySnapshotReader Reader(SnapshotData);
+		for (UInventoryComponent* Inventory : Inventories)
+		{
+			Reader.ReadInventory(Inventory);
+		}
+		const double LoadSeconds = FPlatformTime::Seconds() - StartTime;
+		OutResults.Add({ TEXT("SnapshotLoad"), StacksPerContainer, NumContainers, LoadSeconds });
+
+		UE_LOG(LogTemp, Log, TEXT("InventoryBenchmark snapshot of %d containers is %d bytes, loaded at %.2f MB/s"), NumContainers, SnapshotData.Num(),
+			LoadSeconds > 0.0 ? (SnapshotData.Num() / (1024.0 * 1024.0)) / LoadSeconds : 0.0);
+
+		for (UInventoryComponent* Inventory : Inventories)
+		{
+			Inventory->DestroyComponent();
+		}
+		Owner->Destroy();
+	}
+
+	static bool WriteResults(const TArray<FResult>& Results, const TCHAR* BenchmarkName)
+	{
+		FString Csv = TEXT("Operation,InventorySize,Iterations,TotalMs,AvgUs\n");
+		for (const FResult& Result : Results)
+		{
+			const double AvgUs = Result.Iterations > 0 ? (Result.TotalSeconds * 1000000.0) / Result.Iterations : 0.0;
+			Csv += FString::Printf(TEXT("%s,%d,%d,%.4f,%.4f\n"), *Result.Operation, Result.InventorySize, Result.Iterations, Result.TotalSeconds * 1000.0, AvgUs);
+
+			UE_LOG(LogTemp, Log, TEXT("%s %-20s Size %3d: %.4f us/op"), BenchmarkName, *Result.Operation, Result.InventorySize, AvgUs);
+		}
+
+		const FString FileName = FPaths::Combine(FPaths::ProfilingDir(), TEXT("Benchmarks"), FString::Printf(TEXT("%s-%s.csv"), BenchmarkName, *FDateTime::Now().ToString()));
+		if (FFileHelper::SaveStringToFile(Csv, *FileName))
+		{
+			UE_LOG(LogTemp, Log, TEXT("%s results written to %s"), BenchmarkName, *FileName);
+			return true;
+		}
+
+		UE_LOG(LogTemp, Warning, TEXT("%s couldn't write results to %s"), BenchmarkName, *FileName);
+		return false;
+	}
+}
+
+static FAutoConsoleCommandWithWorldAndArgs InventoryBenchmarkCommand(
+	TEXT("SurvivalGame.InventoryBenchmark"),
+	TEXT("Times inventory operations on inventories of 10, 100 and 300 items and writes a CSV to Saved/Profiling/Benchmarks. Optional arg: iterations per operation (default 10000)"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (!World || World->GetNetMode() == NM_Client)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("InventoryBenchmark needs a world with authority"));
+			return;
+		}
+
+		const int32 Iterations = Args.Num() ? FMath::Max(1, FCString::Atoi(*Args[0])) : 10000;
+
+		TArray<InventoryBenchmark::FResult> Results;
+		InventoryBenchmark::Run(World, Iterations, Results);
+		InventoryBenchmark::WriteResults(Results, TEXT("InventoryBenchmark"));
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs InventorySnapshotBenchmarkCommand(
+	TEXT("SurvivalGame.InventorySnapshotBenchmark"),
+	TEXT("Times capturing, encoding and restoring inventory snapshots of many containers and writes a CSV to Saved/Profiling/Benchmarks. Optional arg: container count (default 2000)"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (!World || World->GetNetMode() == NM_Client)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("InventorySnapshotBenchmark needs a world with authority"));
+			return;
+		}
+
+		const int32 NumContainers = Args.Num() ? FMath::Max(1, FCString::Atoi(*Args[0])) : 2000;
+
+		TArray<InventoryBenchmark::FResult> Results;
+		InventoryBenchmark::RunSnapshot(World, NumContainers, Results);
+		InventoryBenchmark::WriteResults(Results, TEXT("InventorySnapshotBenchmark"));
+	}));
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+//Runs the benchmark in a world of its own so it works headless, e.g. -ExecCmds="Automation RunTests SurvivalGame.Inventory"
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FInventoryBenchmarkTest, "SurvivalGame.Inventory.Benchmark", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool FInventoryBenchmarkTest::RunTest(const FString& Parameters)
+{
+	UWorld* World = UWorld::CreateWorld(EWorldType::Game, false);
+	FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+	WorldContext.SetCurrentWorld(World);
+
+	World->InitializeActorsForPlay(FURL());
+	World->BeginPlay();
+
+	TArray<InventoryBenchmark::FResult> Results;
+	InventoryBenchmark::Run(World, 10000, Results);
+
+	TestTrue(TEXT("Every inventory size produced results"), Results.Num() > 0);
+	TestTrue(TEXT("Results were written to a CSV"), InventoryBenchmark::WriteResults(Results, TEXT("InventoryBenchmark")));
+
+	GEngine->DestroyWorldContext(World);
+	World->DestroyWorld(false);
+	return true;
+}
+
+#endif
+
+#endif
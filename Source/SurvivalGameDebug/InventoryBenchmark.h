@@ -0,0 +1,50 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Items/Item.h"
+#include "InventoryBenchmark.generated.h"
+
+/**
+ * Synthetic items used by the SurvivalGame.InventoryBenchmark console command.
+ * They are hidden from class pickers so they never end up in real content, and SurvivalGameDebug is a developer
+ * tool module so shipping builds don't compile them at all.
+ */
+UCLASS(NotBlueprintable, HideDropdown)
+class SURVIVALGAMEDEBUG_API UBenchmarkStackableItem : public UItem
+{
+	GENERATED_BODY()
+
+public:
+
+	UBenchmarkStackableItem();
+};
+
+UCLASS(NotBlueprintable, HideDropdown)
+class SURVIVALGAMEDEBUG_API UBenchmarkStackableItemB : public UBenchmarkStackableItem
+{
+	GENERATED_BODY()
+};
+
+UCLASS(NotBlueprintable, HideDropdown)
+class SURVIVALGAMEDEBUG_API UBenchmarkStackableItemC : public UBenchmarkStackableItem
+{
+	GENERATED_BODY()
+};
+
+UCLASS(NotBlueprintable, HideDropdown)
+class SURVIVALGAMEDEBUG_API UBenchmarkUnstackableItem : public UItem
+{
+	GENERATED_BODY()
+
+public:
+
+	UBenchmarkUnstackableItem();
+};
+
+UCLASS(NotBlueprintable, HideDropdown)
+class SURVIVALGAMEDEBUG_API UBenchmarkUnstackableItemB : public UBenchmarkUnstackableItem
+{
+	GENERATED_BODY()
+};